@@ -58,6 +58,7 @@ static const char * const opts_suggest[] =
     "--cqm",
     "--demuxer",
     "--direct",
+    "--dither",
     "--frame-packing",
     "--input-csp",
     "--input-fmt",
@@ -108,9 +109,13 @@ static const char * const opts_nosuggest[] =
     "--crop-rect",
     "--deadzone-inter",
     "--deadzone-intra",
+    "--filter-queue",
     "--fps",
+    "--fragment-duration",
     "--frames",
+    "--hls-list-size",
     "--input-depth",
+    "--input-queue",
     "--input-res",
     "--ipratio",
     "--keyint", "-I",
@@ -124,6 +129,7 @@ static const char * const opts_nosuggest[] =
     "--nr",
     "--opencl-device",
     "--output-depth",
+    "--output-queue",
     "--partitions", "-A",
     "--pbratio",
     "--psy-rd",
@@ -136,6 +142,7 @@ static const char * const opts_nosuggest[] =
     "--ratetol",
     "--ref", "-r",
     "--rc-lookahead",
+    "--rendition",
     "--sar",
     "--scenecut",
     "--seek",
@@ -144,8 +151,11 @@ static const char * const opts_nosuggest[] =
     "--slice-max-size",
     "--slice-max-mbs",
     "--slice-min-mbs",
+    "--speed",
+    "--speed-bufsize",
     "--sps-id",
     "--sync-lookahead",
+    "--target-ssim",
     "--threads",
     "--timebase",
     "--vbv-bufsize",
@@ -162,12 +172,14 @@ static const char * const opts_filename[] =
     "--cqmfile",
     "--dump-yuv",
     "--index",
+    "--mb-stats",
     "--opencl-clbin",
     "--output", "-o",
     "--qpfile",
     "--stats",
     "--tcfile-in",
     "--tcfile-out",
+    "--tee",
     NULL
 };
 
@@ -179,11 +191,13 @@ static const char * const opts_standalone[] =
     "--bff",
     "--bluray-compat",
     "--cabac",
+    "--cabac-thread",
     "--constrained-intra",
     "--cpu-independent",
     "--dts-compress",
     "--fake-interlaced",
     "--fast-pskip",
+    "--fast-rd-rate",
     "--filler",
     "--force-cfr",
     "--mbtree",
@@ -210,10 +224,13 @@ static const char * const opts_standalone[] =
     "--sliced-threads",
     "--slow-firstpass",
     "--ssim",
+    "--static-detect",
+    "--stats-only",
     "--stitchable",
     "--tff",
     "--thread-input",
     "--verbose", "-v",
+    "--vif",
     "--weightb",
     NULL
 };
@@ -319,6 +336,8 @@ int x264_cli_autocomplete( const char *prev, const char *cur )
         suggest_list( x264_demuxer_names );
     OPT( "--direct" )
         suggest_list( x264_direct_pred_names );
+    OPT( "--dither" )
+        suggest_list( x264_dither_names );
     OPT( "--frame-packing" )
         suggest_num_range( 0, 7 );
     OPT( "--input-csp" )
@@ -420,12 +420,16 @@ REALIGN_STACK void x264_param_default( x264_param_t *param )
     param->rc.psz_stat_out = "x264_2pass.log";
     param->rc.b_stat_read = 0;
     param->rc.psz_stat_in = "x264_2pass.log";
+    param->rc.b_stats_only = 0;
     param->rc.f_qcompress = 0.6;
     param->rc.f_qblur = 0.5;
     param->rc.f_complexity_blur = 20;
     param->rc.i_zones = 0;
     param->rc.b_mb_tree = 1;
 
+    param->sc.f_speed = 0;
+    param->sc.i_buffer_size = 30;
+
     /* Log */
     param->pf_log = x264_log_default;
     param->p_log_private = NULL;
@@ -457,6 +461,7 @@ REALIGN_STACK void x264_param_default( x264_param_t *param )
     param->analyse.i_luma_deadzone[1] = 11;
     param->analyse.b_psnr = 0;
     param->analyse.b_ssim = 0;
+    param->analyse.b_vif = 0;
 
     param->i_cqm_preset = X264_CQM_FLAT;
     memset( param->cqm_4iy, 16, sizeof( param->cqm_4iy ) );
@@ -967,6 +972,8 @@ REALIGN_STACK int x264_param_parse( x264_param_t *p, const char *name, const cha
     }
     OPT("sliced-threads")
         p->b_sliced_threads = atobool(value);
+    OPT("cabac-thread")
+        p->b_cabac_thread = atobool(value);
     OPT("sync-lookahead")
     {
         if( !strcasecmp(value, "auto") )
@@ -1297,8 +1304,12 @@ REALIGN_STACK int x264_param_parse( x264_param_t *p, const char *name, const cha
         p->analyse.i_trellis = atoi(value);
     OPT("fast-pskip")
         p->analyse.b_fast_pskip = atobool(value);
+    OPT("fast-rd-rate")
+        p->analyse.b_fast_rd_rate = atobool(value);
     OPT("dct-decimate")
         p->analyse.b_dct_decimate = atobool(value);
+    OPT("static-detect")
+        p->analyse.b_static_detect = atobool(value);
     OPT("deadzone-inter")
         p->analyse.i_luma_deadzone[0] = atoi(value);
     OPT("deadzone-intra")
@@ -1322,6 +1333,8 @@ REALIGN_STACK int x264_param_parse( x264_param_t *p, const char *name, const cha
     }
     OPT("crf-max")
         p->rc.f_rf_constant_max = atof(value);
+    OPT("target-ssim")
+        p->rc.f_target_ssim = atof(value);
     OPT("rc-lookahead")
         p->rc.i_lookahead = atoi(value);
     OPT2("qpmin", "qp-min")
@@ -1357,6 +1370,8 @@ REALIGN_STACK int x264_param_parse( x264_param_t *p, const char *name, const cha
         CHECKED_ERROR_PARAM_STRDUP( p->rc.psz_stat_in, p, value );
         CHECKED_ERROR_PARAM_STRDUP( p->rc.psz_stat_out, p, value );
     }
+    OPT("stats-only")
+        p->rc.b_stats_only = atobool(value);
     OPT("qcomp")
         p->rc.f_qcompress = atof(value);
     OPT("mbtree")
@@ -1367,6 +1382,10 @@ REALIGN_STACK int x264_param_parse( x264_param_t *p, const char *name, const cha
         p->rc.f_complexity_blur = atof(value);
     OPT("zones")
         CHECKED_ERROR_PARAM_STRDUP( p->rc.psz_zones, p, value );
+    OPT("speed")
+        p->sc.f_speed = atof(value);
+    OPT("speed-bufsize")
+        p->sc.i_buffer_size = atoi(value);
     OPT("crop-rect")
         b_error |= sscanf( value, "%d,%d,%d,%d", &p->crop_rect.i_left, &p->crop_rect.i_top,
                                                  &p->crop_rect.i_right, &p->crop_rect.i_bottom ) != 4;
@@ -1374,6 +1393,10 @@ REALIGN_STACK int x264_param_parse( x264_param_t *p, const char *name, const cha
         p->analyse.b_psnr = atobool(value);
     OPT("ssim")
         p->analyse.b_ssim = atobool(value);
+    OPT("vif")
+        p->analyse.b_vif = atobool(value);
+    OPT("mb-stats")
+        p->analyse.b_mb_stats = atobool(value);
     OPT("aud")
         p->b_aud = atobool(value);
     OPT("sps-id")
@@ -1459,7 +1482,11 @@ char *x264_param2string( x264_param_t *p, int b_res )
     s += sprintf( s, " me_range=%d", p->analyse.i_me_range );
     s += sprintf( s, " chroma_me=%d", p->analyse.b_chroma_me );
     s += sprintf( s, " trellis=%d", p->analyse.i_trellis );
+    if( p->analyse.b_fast_rd_rate )
+        s += sprintf( s, " fast_rd_rate=%d", p->analyse.b_fast_rd_rate );
     s += sprintf( s, " 8x8dct=%d", p->analyse.b_transform_8x8 );
+    if( p->analyse.b_static_detect )
+        s += sprintf( s, " static_detect=%d", p->analyse.b_static_detect );
     s += sprintf( s, " cqm=%d", p->i_cqm_preset );
     s += sprintf( s, " deadzone=%d,%d", p->analyse.i_luma_deadzone[0], p->analyse.i_luma_deadzone[1] );
     s += sprintf( s, " fast_pskip=%d", p->analyse.b_fast_pskip );
@@ -1467,6 +1494,8 @@ char *x264_param2string( x264_param_t *p, int b_res )
     s += sprintf( s, " threads=%d", p->i_threads );
     s += sprintf( s, " lookahead_threads=%d", p->i_lookahead_threads );
     s += sprintf( s, " sliced_threads=%d", p->b_sliced_threads );
+    if( p->b_cabac_thread )
+        s += sprintf( s, " cabac_thread=%d", p->b_cabac_thread );
     if( p->i_slice_count )
         s += sprintf( s, " slices=%d", p->i_slice_count );
     if( p->i_slice_count_max )
@@ -1511,7 +1540,11 @@ char *x264_param2string( x264_param_t *p, int b_res )
     if( p->rc.i_rc_method == X264_RC_ABR || p->rc.i_rc_method == X264_RC_CRF )
     {
         if( p->rc.i_rc_method == X264_RC_CRF )
+        {
             s += sprintf( s, " crf=%.1f", p->rc.f_rf_constant );
+            if( p->rc.f_target_ssim > 0 )
+                s += sprintf( s, " target_ssim=%.5f", p->rc.f_target_ssim );
+        }
         else
             s += sprintf( s, " bitrate=%d ratetol=%.1f",
                           p->rc.i_bitrate, p->rc.f_rate_tolerance );
@@ -1562,6 +1595,8 @@ char *x264_param2string( x264_param_t *p, int b_res )
         else if( p->rc.i_zones )
             s += sprintf( s, " zones" );
     }
+    if( p->sc.f_speed > 0 )
+        s += sprintf( s, " speed=%.2f speed_bufsize=%d", p->sc.f_speed, p->sc.i_buffer_size );
 
     return buf;
 }
@@ -108,6 +108,7 @@ void x264_bitstream_init( uint32_t cpu, x264_bitstream_function_t *pf )
     memset( pf, 0, sizeof(*pf) );
 
     pf->nal_escape = nal_escape_c;
+    pf->cabac_block_residual_bits = x264_cabac_block_residual_bits_c;
 #if HAVE_MMX
 #if ARCH_X86_64
     pf->cabac_block_residual_internal = x264_cabac_block_residual_internal_sse2;
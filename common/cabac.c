@@ -182,3 +182,35 @@ void x264_cabac_encode_flush( x264_t *h, x264_cabac_t *cb )
     }
 }
 
+
+/* RD size of a residual block with frozen context states: each flag is a table lookup
+ * rather than a serial state update. */
+int x264_cabac_block_residual_bits_c( dctcoef *l, int last, const x264_cabac_rd_table_t *t )
+{
+    /* same as coeff_abs_level_transition in encoder/cabac.c */
+    static const uint8_t level_transition[2][8] =
+    {
+        { 1, 2, 3, 3, 4, 5, 6, 7 },
+        { 4, 4, 4, 4, 5, 6, 7, 7 }
+    };
+    int abs_level = abs(l[last]);
+    int bits = t->sig[last][1] + t->last[last][1] + t->level[0][X264_MIN(abs_level,15)-1];
+    int node_ctx = level_transition[abs_level > 1][0];
+    if( abs_level >= 15 )
+        bits += bs_size_ue_big( abs_level - 15 ) << 8;
+
+    for( int i = last-1; i >= 0; i-- )
+    {
+        if( l[i] )
+        {
+            abs_level = abs(l[i]);
+            bits += t->sig[i][1] + t->last[i][0] + t->level[node_ctx][X264_MIN(abs_level,15)-1];
+            node_ctx = level_transition[abs_level > 1][node_ctx];
+            if( abs_level >= 15 )
+                bits += bs_size_ue_big( abs_level - 15 ) << 8;
+        }
+        else
+            bits += t->sig[i][0];
+    }
+    return bits;
+}
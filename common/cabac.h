@@ -51,6 +51,15 @@ typedef struct
     uint8_t padding[12];
 } x264_cabac_t;
 
+/* Residual bit costs for fast RD rate estimation, built per ctx_block_cat from the context
+ * states at the start of a macroblock and not adapted while coding it. In 1/256 bits. */
+typedef struct
+{
+    uint16_t sig[64][2];    /* significant_coeff_flag by coefficient position, 0 for the last position */
+    uint16_t last[64][2];   /* last_significant_coeff_flag by coefficient position, 0 for the last position */
+    uint16_t level[8][16];  /* coeff_abs_level_minus1 prefix and sign by node ctx and min(abs,15)-1 */
+} x264_cabac_rd_table_t;
+
 /* init the contexts given i_slice_type, the quantif and the model */
 #define x264_cabac_context_init x264_template(cabac_context_init)
 void x264_cabac_context_init( x264_t *h, x264_cabac_t *cb, int i_slice_type, int i_qp, int i_model );
@@ -75,6 +84,8 @@ void x264_cabac_encode_terminal_asm( x264_cabac_t *cb );
 void x264_cabac_encode_ue_bypass( x264_cabac_t *cb, int exp_bits, int val );
 #define x264_cabac_encode_flush x264_template(cabac_encode_flush)
 void x264_cabac_encode_flush( x264_t *h, x264_cabac_t *cb );
+#define x264_cabac_block_residual_bits_c x264_template(cabac_block_residual_bits_c)
+int x264_cabac_block_residual_bits_c( dctcoef *l, int last, const x264_cabac_rd_table_t *t );
 
 #if HAVE_MMX
 #define x264_cabac_encode_decision x264_cabac_encode_decision_asm
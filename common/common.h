@@ -229,6 +229,8 @@ typedef struct x264_lookahead_t
 } x264_lookahead_t;
 
 typedef struct x264_ratecontrol_t   x264_ratecontrol_t;
+typedef struct x264_mb_writer_t     x264_mb_writer_t;
+typedef struct x264_speedcontrol_t  x264_speedcontrol_t;
 
 typedef struct x264_left_table_t
 {
@@ -239,6 +241,16 @@ typedef struct x264_left_table_t
     uint8_t ref[4];
 } x264_left_table_t;
 
+/* luma mbcmp of one 8x8 block at one subpel mv */
+typedef struct
+{
+    pixel *fref;
+    const x264_weight_t *weight;
+    uint32_t mv;
+    uint32_t i_gen;
+    int cost;
+} x264_subpel_cache_t;
+
 /* Current frame stats */
 typedef struct
 {
@@ -248,6 +260,11 @@ typedef struct
     int i_tex_bits;
     /* ? */
     int i_misc_bits;
+    /* Bits counted but not written (CABAC in a stats-only pass) */
+    int i_sized_bits;
+    /* Fractions of a bit of mv and texture not yet counted (stats-only pass) */
+    int i_sized_mv_f8;
+    int i_sized_tex_f8;
     /* MB type counts */
     int i_mb_count[19];
     int i_mb_count_i;
@@ -265,6 +282,7 @@ typedef struct
     int64_t i_ssd[3];
     double f_ssim;
     int i_ssim_cnt;
+    double f_vif[2]; /* numerator, denominator */
 } x264_frame_stat_t;
 
 struct x264_t
@@ -284,6 +302,8 @@ struct x264_t
     int             i_threadslice_pass; /* which pass of encoding we are on */
     x264_threadpool_t *threadpool;
     x264_threadpool_t *lookaheadpool;
+    x264_threadpool_t *writepool;   /* cabac writer threads, if b_cabac_thread */
+    x264_mb_writer_t *mb_writer;    /* this thread's cabac writer */
     x264_pthread_mutex_t mutex;
     x264_pthread_cond_t cv;
 
@@ -521,6 +541,8 @@ struct x264_t
         int8_t  *type;                      /* mb type */
         uint8_t *partition;                 /* mb partition */
         int8_t  *qp;                        /* mb qp */
+        uint32_t *ssd;                      /* mb ssd, luma+chroma (analyse.b_mb_stats) */
+        float   *ssim;                      /* mb luma ssim (analyse.b_mb_stats) */
         int16_t *cbp;                       /* mb cbp: 0x0?: luma, 0x?0: chroma, 0x100: luma dc, 0x200 and 0x400: chroma dc, 0x1000 PCM (all set for PCM) */
         int8_t  (*intra4x4_pred_mode)[8];   /* intra4x4 pred mode. for non I4x4 set to I_PRED_4x4_DC(2) */
                                             /* actually has only 7 entries; set to 8 for write-combining optimizations */
@@ -610,6 +632,17 @@ struct x264_t
             int     i_stride[3];
         } pic;
 
+        /* luma mbcmp of each 8x8 block at subpel mvs already tested in this mb, so that
+         * the partitions of one mb searching the same ref don't recompute them.
+         * entries are only valid if i_gen matches the generation of the current mb. */
+        x264_subpel_cache_t subpel_cache[4][64];
+        uint32_t i_subpel_cache_gen;
+
+        /* fast RD rate estimation: residual costs per ctx_block_cat from the cabac
+         * states at the start of the mb, built on first use */
+        uint32_t i_cabac_rd_valid;
+        x264_cabac_rd_table_t cabac_rd[14];
+
         /* cache */
         struct
         {
@@ -680,6 +713,8 @@ struct x264_t
 
     /* rate control encoding only */
     x264_ratecontrol_t *rc;
+    /* speed control, shared by all threads */
+    x264_speedcontrol_t *sc;
 
     /* stats */
     struct
@@ -698,6 +733,7 @@ struct x264_t
         double  f_psnr_mean_u[3];
         double  f_psnr_mean_v[3];
         double  f_ssim_mean_y[3];
+        double  f_vif_mean_y[3];
         double  f_frame_duration[3];
         /* */
         int64_t i_mb_count[3][19];
@@ -735,6 +771,10 @@ struct x264_t
     /* Deblock strength values are stored for each 4x4 partition. In MBAFF
      * there are four extra values that need to be stored, located in [4][i]. */
     uint8_t (*deblock_strength[2])[2][8][4];
+    /* Per mb column of the current hpel band: 1 if its source pixels are unchanged from the reference. */
+    uint8_t *hpel_static;
+    /* 4x4 block sums of the last ssim row, carried over to the next band. */
+    void *ssim_sums;
 
     /* CPU functions dependents */
     x264_predict_t      predict_16x16[4+3];
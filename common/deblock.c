@@ -375,6 +375,19 @@ static ALWAYS_INLINE void macroblock_cache_load_neighbours_deblock( x264_t *h, i
         h->mb.i_neighbour |= MB_TOP;
 }
 
+/* Whether a progressive mb has no edge that would be filtered: neither it nor its left/top
+ * neighbours are intra, and every strength it would use is zero.  Only reads the per-mb
+ * arrays and the strengths computed during encoding, so it is much cheaper than loading
+ * the neighbour context and walking the edges. */
+static ALWAYS_INLINE int deblock_mb_is_noop( x264_t *h, uint8_t (*bs)[8][4], int mb_xy, int mb_x, int mb_y )
+{
+    if( IS_INTRA( h->mb.type[mb_xy] ) ||
+        (mb_x > 0 && IS_INTRA( h->mb.type[mb_xy-1] )) ||
+        (mb_y > 0 && IS_INTRA( h->mb.type[mb_xy-h->mb.i_mb_stride] )) )
+        return 0;
+    return !(M64( bs[0][0] ) | M64( bs[0][2] ) | M64( bs[1][0] ) | M64( bs[1][2] ));
+}
+
 void x264_frame_deblock_row( x264_t *h, int mb_y )
 {
     int b_interlaced = SLICE_MBAFF;
@@ -390,6 +403,15 @@ void x264_frame_deblock_row( x264_t *h, int mb_y )
 
     for( int mb_x = 0; mb_x < h->mb.i_mb_width; mb_x += (~b_interlaced | mb_y)&1, mb_y ^= b_interlaced )
     {
+        /* Static and smooth areas are mostly mbs with nothing to filter; skip those
+         * before touching any neighbour state. */
+        if( !b_interlaced )
+        {
+            int mb_xy = mb_y * h->mb.i_mb_stride + mb_x;
+            if( deblock_mb_is_noop( h, h->deblock_strength[mb_y&1][h->param.b_sliced_threads?mb_xy:mb_x], mb_xy, mb_x, mb_y ) )
+                continue;
+        }
+
         x264_prefetch_fenc( h, h->fdec, mb_x, mb_y );
         macroblock_cache_load_neighbours_deblock( h, mb_x, mb_y );
 
@@ -226,6 +226,7 @@ static x264_frame_t *frame_new( x264_t *h, int b_fdec )
             if( h->frames.b_have_lowres )
                 PREALLOC( frame->i_inv_qscale_factor, i_mb_count * sizeof(uint16_t) );
         }
+        PREALLOC( frame->mb_effort, i_mb_count * sizeof(uint8_t) );
 
         /* mbtree asm can overread the input buffers, make sure we don't read outside of allocated memory. */
         if( h->frames.b_have_lowres )
@@ -66,6 +66,7 @@ typedef struct x264_frame
     float   f_qp_avg_rc; /* QPs as decided by ratecontrol */
     float   f_qp_avg_aq; /* QPs as decided by AQ in addition to ratecontrol */
     float   f_crf_avg;   /* Average effective CRF for this frame */
+    float   f_crf_offset; /* CRF offset of --target-ssim this frame was coded with */
     int     i_poc_l0ref0; /* poc of first refframe in L0, used to check if direct temporal is possible */
 
     /* YUV buffer */
@@ -131,6 +132,8 @@ typedef struct x264_frame
     float   *f_row_qscale;
     float   *f_qp_offset;
     float   *f_qp_offset_aq;
+    uint8_t *mb_effort; /* X264_EFFORT_* per mb, valid if b_mb_effort */
+    int     b_mb_effort;
     int     b_intra_calculated;
     uint16_t *i_intra_cost;
     uint16_t *i_propagate_cost;
@@ -243,7 +246,7 @@ void          x264_frame_deblock_row( x264_t *h, int mb_y );
 void          x264_macroblock_deblock( x264_t *h );
 
 #define x264_frame_filter x264_template(frame_filter)
-void          x264_frame_filter( x264_t *h, x264_frame_t *frame, int mb_y, int b_end );
+void          x264_frame_filter( x264_t *h, x264_frame_t *frame, int mb_y, int b_end, x264_frame_t *ref, uint8_t *b_static );
 #define x264_frame_init_lowres x264_template(frame_init_lowres)
 void          x264_frame_init_lowres( x264_t *h, x264_frame_t *frame );
 
@@ -258,6 +258,11 @@ int x264_macroblock_cache_allocate( x264_t *h )
     PREALLOC_INIT
 
     PREALLOC( h->mb.qp, i_mb_count * sizeof(int8_t) );
+    if( h->param.analyse.b_mb_stats )
+    {
+        PREALLOC( h->mb.ssd, i_mb_count * sizeof(uint32_t) );
+        PREALLOC( h->mb.ssim, i_mb_count * sizeof(float) );
+    }
     PREALLOC( h->mb.cbp, i_mb_count * sizeof(int16_t) );
     PREALLOC( h->mb.mb_transform_size, i_mb_count * sizeof(int8_t) );
     PREALLOC( h->mb.slice_table, i_mb_count * sizeof(int32_t) );
@@ -375,6 +380,9 @@ int x264_macroblock_thread_allocate( x264_t *h, int b_lookahead )
                 CHECKED_MALLOC( h->deblock_strength[i], sizeof(**h->deblock_strength) * h->mb.i_mb_width );
             h->deblock_strength[1] = h->deblock_strength[i];
         }
+        CHECKED_MALLOC( h->hpel_static, h->mb.i_mb_width );
+        if( h->param.analyse.b_ssim )
+            CHECKED_MALLOC( h->ssim_sums, 8 * (h->param.i_width/4+3) * sizeof(int) );
     }
 
     /* Allocate scratch buffer */
@@ -382,11 +390,10 @@ int x264_macroblock_thread_allocate( x264_t *h, int b_lookahead )
     if( !b_lookahead )
     {
         int buf_hpel = (h->thread[0]->fdec->i_width[0]+48+32) * sizeof(int16_t);
-        int buf_ssim = h->param.analyse.b_ssim * 8 * (h->param.i_width/4+3) * sizeof(int);
         int me_range = X264_MIN(h->param.analyse.i_me_range, h->param.analyse.i_mv_range);
         int buf_tesa = (h->param.analyse.i_me_method >= X264_ME_ESA) *
             ((me_range*2+24) * sizeof(int16_t) + (me_range+4) * (me_range+1) * 4 * sizeof(mvsad_t));
-        scratch_size = X264_MAX3( buf_hpel, buf_ssim, buf_tesa );
+        scratch_size = X264_MAX( buf_hpel, buf_tesa );
     }
     int buf_mbtree = h->param.rc.b_mb_tree * ALIGN( h->mb.i_mb_width * sizeof(int16_t), NATIVE_ALIGN );
     scratch_size = X264_MAX( scratch_size, buf_mbtree );
@@ -415,6 +422,8 @@ void x264_macroblock_thread_free( x264_t *h, int b_lookahead )
         for( int i = 0; i < (PARAM_INTERLACED ? 5 : 2); i++ )
             for( int j = 0; j < (CHROMA444 ? 3 : 2); j++ )
                 x264_free( h->intra_border_backup[i][j] - 16 );
+        x264_free( h->hpel_static );
+        x264_free( h->ssim_sums );
     }
     x264_free( h->scratch_buffer );
     x264_free( h->scratch_buffer2 );
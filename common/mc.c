@@ -701,7 +701,31 @@ void x264_mc_init( uint32_t cpu, x264_mc_functions_t *pf, int cpu_independent )
     }
 }
 
-void x264_frame_filter( x264_t *h, x264_frame_t *frame, int mb_y, int b_end )
+/* Run the hpel filter over columns [x0,x1) of mb columns of the band, or copy the band
+ * from the reference's filtered planes where the source pixels are known to be unchanged. */
+static void frame_filter_run( x264_t *h, x264_frame_t *frame, x264_frame_t *ref, int p,
+                              int start, int height, int x0, int x1, int b_copy )
+{
+    int stride = frame->i_stride[p];
+    int offs = start*stride + 16*x0 - 8;
+    int width = 16*(x1-x0) + 16;
+    if( b_copy )
+    {
+        for( int i = 1; i < 4; i++ )
+            for( int y = 0; y < height - start; y++ )
+                memcpy( frame->filtered[p][i] + offs + y*stride, ref->filtered[p][i] + offs + y*stride, width * SIZEOF_PIXEL );
+    }
+    else
+        h->mc.hpel_filter(
+            frame->filtered[p][1] + offs,
+            frame->filtered[p][2] + offs,
+            frame->filtered[p][3] + offs,
+            frame->plane[p] + offs,
+            stride, width, height - start,
+            h->scratch_buffer );
+}
+
+void x264_frame_filter( x264_t *h, x264_frame_t *frame, int mb_y, int b_end, x264_frame_t *ref, uint8_t *b_static )
 {
     const int b_interlaced = PARAM_INTERLACED;
     int start = mb_y*16 - 8; // buffer = 4 for deblock + 3 for 6tap, rounded to 8
@@ -716,7 +740,16 @@ void x264_frame_filter( x264_t *h, x264_frame_t *frame, int mb_y, int b_end )
         const int width = frame->i_width[p];
         int offs = start*stride - 8; // buffer = 3 for 6tap, aligned to 8 for simd
 
-        if( !b_interlaced || h->mb.b_adaptive_mbaff )
+        if( ref && !b_interlaced )
+        {
+            /* Split the band into runs of static and changed mb columns. */
+            for( int x0 = 0, x1; x0 < h->mb.i_mb_width; x0 = x1 )
+            {
+                for( x1 = x0+1; x1 < h->mb.i_mb_width && b_static[x1] == b_static[x0]; x1++ );
+                frame_filter_run( h, frame, ref, p, start, height, x0, x1, b_static[x0] );
+            }
+        }
+        else if( !b_interlaced || h->mb.b_adaptive_mbaff )
             h->mc.hpel_filter(
                 frame->filtered[p][1] + offs,
                 frame->filtered[p][2] + offs,
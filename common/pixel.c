@@ -687,12 +687,15 @@ static float ssim_end4( int sum0[5][4], int sum1[5][4], int width )
     return ssim;
 }
 
-float x264_pixel_ssim_wxh( x264_pixel_function_t *pf,
-                           pixel *pix1, intptr_t stride1,
-                           pixel *pix2, intptr_t stride2,
-                           int width, int height, void *buf, int *cnt )
+/* Consecutive bands of a frame overlap by one row of 4x4 blocks. With b_resume, the
+ * sums of that row are taken from buf, as left there by the previous band, instead
+ * of being recomputed; the result is the same either way. */
+float x264_pixel_ssim_rows( x264_pixel_function_t *pf,
+                            pixel *pix1, intptr_t stride1,
+                            pixel *pix2, intptr_t stride2,
+                            int width, int height, void *buf, int *cnt, int b_resume )
 {
-    int z = 0;
+    int z = !!b_resume;
     float ssim = 0.0;
     int (*sum0)[4] = buf;
     int (*sum1)[4] = sum0 + (width >> 2) + 3;
@@ -709,10 +712,111 @@ float x264_pixel_ssim_wxh( x264_pixel_function_t *pf,
         for( int x = 0; x < width-1; x += 4 )
             ssim += pf->ssim_end4( sum0+x, sum1+x, X264_MIN(4,width-x-1) );
     }
+    /* Leave the last row where the next band expects it. */
+    if( (void*)sum0 != buf )
+        memcpy( buf, sum0, width * sizeof(*sum0) );
     *cnt = (height-1) * (width-1);
     return ssim;
 }
 
+float x264_pixel_ssim_wxh( x264_pixel_function_t *pf,
+                           pixel *pix1, intptr_t stride1,
+                           pixel *pix2, intptr_t stride2,
+                           int width, int height, void *buf, int *cnt )
+{
+    return x264_pixel_ssim_rows( pf, pix1, stride1, pix2, stride2, width, height, buf, cnt, 0 );
+}
+
+/****************************************************************************
+ * visual information fidelity
+ ****************************************************************************/
+/* Pixel-domain VIF as used by VMAF, computed over non-overlapping windows: 8x8
+ * windows for the fine scale and 16x16 windows for the coarse one, instead of
+ * gaussian-filtered and decimated planes. That makes it cheap enough to run in
+ * the loop; it tracks VMAF's vif features but isn't numerically identical. */
+static void vif_sums_8x8( const pixel *pix1, intptr_t stride1, const pixel *pix2, intptr_t stride2, int64_t sums[5] )
+{
+    uint32_t s1 = 0, s2 = 0, s11 = 0, s22 = 0, s12 = 0;
+    for( int y = 0; y < 8; y++, pix1 += stride1, pix2 += stride2 )
+        for( int x = 0; x < 8; x++ )
+        {
+            int a = pix1[x];
+            int b = pix2[x];
+            s1  += a;
+            s2  += b;
+            s11 += a*a;
+            s22 += b*b;
+            s12 += a*b;
+        }
+    sums[0] = s1;
+    sums[1] = s2;
+    sums[2] = s11;
+    sums[3] = s22;
+    sums[4] = s12;
+}
+
+static void vif_window( const int64_t sums[5], int n, double vif[2] )
+{
+    static const double sigma_nsq = 2.0;
+    static const double eps = 1e-10;
+    /* Variances in units of 8-bit pixels. */
+    double norm = 1.0 / ((double)n * n * (1 << (2*(BIT_DEPTH-8))));
+    double sigma1_sq = (n * sums[2] - sums[0] * sums[0]) * norm;
+    double sigma2_sq = (n * sums[3] - sums[1] * sums[1]) * norm;
+    double sigma12   = (n * sums[4] - sums[0] * sums[1]) * norm;
+    double g, sv_sq;
+
+    sigma1_sq = X264_MAX( sigma1_sq, 0 );
+    sigma2_sq = X264_MAX( sigma2_sq, 0 );
+    g = sigma12 / (sigma1_sq + eps);
+    sv_sq = sigma2_sq - g * sigma12;
+    if( sigma1_sq < eps )
+    {
+        g = 0;
+        sv_sq = sigma2_sq;
+        sigma1_sq = 0;
+    }
+    if( sigma2_sq < eps )
+    {
+        g = 0;
+        sv_sq = 0;
+    }
+    if( g < 0 )
+    {
+        sv_sq = sigma2_sq;
+        g = 0;
+    }
+    sv_sq = X264_MAX( sv_sq, eps );
+    vif[0] += log10( 1.0 + g * g * sigma1_sq / (sv_sq + sigma_nsq) );
+    vif[1] += log10( 1.0 + sigma1_sq / sigma_nsq );
+}
+
+/* Accumulates the numerator and denominator of VIF between pix1 (reference) and
+ * pix2 over a band of 16x16 tiles; partial tiles at the edges only count their
+ * whole 8x8 windows. */
+void x264_pixel_vif_wxh( pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2,
+                         int i_width, int i_height, double vif[2] )
+{
+    for( int y = 0; y <= i_height-8; y += 16 )
+        for( int x = 0; x <= i_width-8; x += 16 )
+        {
+            int64_t tile[5] = {0};
+            int windows = 0;
+            for( int by = y; by < y+16 && by <= i_height-8; by += 8 )
+                for( int bx = x; bx < x+16 && bx <= i_width-8; bx += 8 )
+                {
+                    int64_t sums[5];
+                    vif_sums_8x8( pix1 + by*i_pix1 + bx, i_pix1, pix2 + by*i_pix2 + bx, i_pix2, sums );
+                    for( int i = 0; i < 5; i++ )
+                        tile[i] += sums[i];
+                    vif_window( sums, 64, vif );
+                    windows++;
+                }
+            if( windows == 4 )
+                vif_window( tile, 256, vif );
+        }
+}
+
 static int pixel_vsad( pixel *src, intptr_t stride, int height )
 {
     int score = 0;
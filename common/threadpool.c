@@ -23,7 +23,8 @@
  * For more information, contact us at licensing@x264.com.
  *****************************************************************************/
 
-#include "common.h"
+#include "base.h"
+#include "threadpool.h"
 
 typedef struct
 {
@@ -32,19 +33,65 @@ typedef struct
     void *ret;
 } x264_threadpool_job_t;
 
+/* synchronized job list. The pool has as many jobs as threads, so a list can
+ * always take a job and pushing never has to wait. */
+typedef struct
+{
+    x264_threadpool_job_t **list;
+    int i_size;
+    x264_pthread_mutex_t mutex;
+    x264_pthread_cond_t  cv_fill; /* event signaling that the list became fuller */
+} x264_sync_job_list_t;
+
 struct x264_threadpool_t
 {
     volatile int   exit;
     int            threads;
     x264_pthread_t *thread_handle;
 
-    /* requires a synchronized list structure and associated methods,
-       so use what is already implemented for frames */
-    x264_sync_frame_list_t uninit; /* list of jobs that are awaiting use */
-    x264_sync_frame_list_t run;    /* list of jobs that are queued for processing by the pool */
-    x264_sync_frame_list_t done;   /* list of jobs that have finished processing */
+    x264_sync_job_list_t uninit; /* list of jobs that are awaiting use */
+    x264_sync_job_list_t run;    /* list of jobs that are queued for processing by the pool */
+    x264_sync_job_list_t done;   /* list of jobs that have finished processing */
 };
 
+static int job_list_init( x264_sync_job_list_t *slist, int max_size )
+{
+    slist->i_size = 0;
+    CHECKED_MALLOCZERO( slist->list, max_size * sizeof(x264_threadpool_job_t*) );
+    if( x264_pthread_mutex_init( &slist->mutex, NULL ) ||
+        x264_pthread_cond_init( &slist->cv_fill, NULL ) )
+        return -1;
+    return 0;
+fail:
+    return -1;
+}
+
+static void job_list_delete( x264_sync_job_list_t *slist )
+{
+    x264_pthread_mutex_destroy( &slist->mutex );
+    x264_pthread_cond_destroy( &slist->cv_fill );
+    for( int i = 0; i < slist->i_size; i++ )
+        x264_free( slist->list[i] );
+    x264_free( slist->list );
+}
+
+static void job_list_push( x264_sync_job_list_t *slist, x264_threadpool_job_t *job )
+{
+    x264_pthread_mutex_lock( &slist->mutex );
+    slist->list[ slist->i_size++ ] = job;
+    x264_pthread_mutex_unlock( &slist->mutex );
+    x264_pthread_cond_broadcast( &slist->cv_fill );
+}
+
+/* Remove job i of a locked list, keeping the order of the others. */
+static x264_threadpool_job_t *job_list_remove( x264_sync_job_list_t *slist, int i )
+{
+    x264_threadpool_job_t *job = slist->list[i];
+    slist->i_size--;
+    memmove( slist->list + i, slist->list + i + 1, (slist->i_size - i) * sizeof(x264_threadpool_job_t*) );
+    return job;
+}
+
 REALIGN_STACK static void *threadpool_thread( x264_threadpool_t *pool )
 {
     while( !pool->exit )
@@ -54,15 +101,12 @@ REALIGN_STACK static void *threadpool_thread( x264_threadpool_t *pool )
         while( !pool->exit && !pool->run.i_size )
             x264_pthread_cond_wait( &pool->run.cv_fill, &pool->run.mutex );
         if( pool->run.i_size )
-        {
-            job = (void*)x264_frame_shift( pool->run.list );
-            pool->run.i_size--;
-        }
+            job = job_list_remove( &pool->run, 0 );
         x264_pthread_mutex_unlock( &pool->run.mutex );
         if( !job )
             continue;
         job->ret = job->func( job->arg );
-        x264_sync_frame_list_push( &pool->done, (void*)job );
+        job_list_push( &pool->done, job );
     }
     return NULL;
 }
@@ -83,16 +127,16 @@ int x264_threadpool_init( x264_threadpool_t **p_pool, int threads )
 
     CHECKED_MALLOC( pool->thread_handle, pool->threads * sizeof(x264_pthread_t) );
 
-    if( x264_sync_frame_list_init( &pool->uninit, pool->threads ) ||
-        x264_sync_frame_list_init( &pool->run, pool->threads ) ||
-        x264_sync_frame_list_init( &pool->done, pool->threads ) )
+    if( job_list_init( &pool->uninit, pool->threads ) ||
+        job_list_init( &pool->run, pool->threads ) ||
+        job_list_init( &pool->done, pool->threads ) )
         goto fail;
 
     for( int i = 0; i < pool->threads; i++ )
     {
        x264_threadpool_job_t *job;
        CHECKED_MALLOC( job, sizeof(x264_threadpool_job_t) );
-       x264_sync_frame_list_push( &pool->uninit, (void*)job );
+       job_list_push( &pool->uninit, job );
     }
     for( int i = 0; i < pool->threads; i++ )
         if( x264_pthread_create( pool->thread_handle+i, NULL, (void*)threadpool_thread, pool ) )
@@ -105,10 +149,14 @@ fail:
 
 void x264_threadpool_run( x264_threadpool_t *pool, void *(*func)(void *), void *arg )
 {
-    x264_threadpool_job_t *job = (void*)x264_sync_frame_list_pop( &pool->uninit );
+    x264_pthread_mutex_lock( &pool->uninit.mutex );
+    while( !pool->uninit.i_size )
+        x264_pthread_cond_wait( &pool->uninit.cv_fill, &pool->uninit.mutex );
+    x264_threadpool_job_t *job = job_list_remove( &pool->uninit, pool->uninit.i_size - 1 );
+    x264_pthread_mutex_unlock( &pool->uninit.mutex );
     job->func = func;
     job->arg  = arg;
-    x264_sync_frame_list_push( &pool->run, (void*)job );
+    job_list_push( &pool->run, job );
 }
 
 void *x264_threadpool_wait( x264_threadpool_t *pool, void *arg )
@@ -117,14 +165,13 @@ void *x264_threadpool_wait( x264_threadpool_t *pool, void *arg )
     while( 1 )
     {
         for( int i = 0; i < pool->done.i_size; i++ )
-            if( ((x264_threadpool_job_t*)pool->done.list[i])->arg == arg )
+            if( pool->done.list[i]->arg == arg )
             {
-                x264_threadpool_job_t *job = (void*)x264_frame_shift( pool->done.list+i );
-                pool->done.i_size--;
+                x264_threadpool_job_t *job = job_list_remove( &pool->done, i );
                 x264_pthread_mutex_unlock( &pool->done.mutex );
 
                 void *ret = job->ret;
-                x264_sync_frame_list_push( &pool->uninit, (void*)job );
+                job_list_push( &pool->uninit, job );
                 return ret;
             }
 
@@ -132,16 +179,6 @@ void *x264_threadpool_wait( x264_threadpool_t *pool, void *arg )
     }
 }
 
-static void threadpool_list_delete( x264_sync_frame_list_t *slist )
-{
-    for( int i = 0; slist->list[i]; i++ )
-    {
-        x264_free( slist->list[i] );
-        slist->list[i] = NULL;
-    }
-    x264_sync_frame_list_delete( slist );
-}
-
 void x264_threadpool_delete( x264_threadpool_t *pool )
 {
     x264_pthread_mutex_lock( &pool->run.mutex );
@@ -151,9 +188,9 @@ void x264_threadpool_delete( x264_threadpool_t *pool )
     for( int i = 0; i < pool->threads; i++ )
         x264_pthread_join( pool->thread_handle[i], NULL );
 
-    threadpool_list_delete( &pool->uninit );
-    threadpool_list_delete( &pool->run );
-    threadpool_list_delete( &pool->done );
+    job_list_delete( &pool->uninit );
+    job_list_delete( &pool->run );
+    job_list_delete( &pool->done );
     x264_free( pool->thread_handle );
     x264_free( pool );
 }
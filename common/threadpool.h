@@ -29,13 +29,9 @@
 typedef struct x264_threadpool_t x264_threadpool_t;
 
 #if HAVE_THREAD
-#define x264_threadpool_init x264_template(threadpool_init)
 X264_API int   x264_threadpool_init( x264_threadpool_t **p_pool, int threads );
-#define x264_threadpool_run x264_template(threadpool_run)
 X264_API void  x264_threadpool_run( x264_threadpool_t *pool, void *(*func)(void *), void *arg );
-#define x264_threadpool_wait x264_template(threadpool_wait)
 X264_API void *x264_threadpool_wait( x264_threadpool_t *pool, void *arg );
-#define x264_threadpool_delete x264_template(threadpool_delete)
 X264_API void  x264_threadpool_delete( x264_threadpool_t *pool );
 #else
 #define x264_threadpool_init(p,t) -1
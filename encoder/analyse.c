@@ -63,6 +63,11 @@ typedef struct
     uint16_t *p_cost_ref[2];
     int i_mbrd;
 
+    /* Settings for this mb: the encoder's, capped by the mb's effort level. */
+    int i_subpel_refine;
+    int i_trellis;
+    unsigned int i_intra;
+    unsigned int i_inter;
 
     /* I: Intra part */
     /* Take some shortcuts in intra search if intra is deemed unlikely */
@@ -138,6 +143,21 @@ static const uint8_t i_sub_mb_p_cost_table[4] =
     5, 3, 3, 1
 };
 
+/* Upper limits on the analysis settings for each X264_EFFORT_* level. */
+static const struct
+{
+    uint8_t subme;
+    uint8_t me;
+    uint8_t trellis;
+    uint16_t partitions;
+} mb_effort_limits[X264_EFFORT_MINIMAL+1] =
+{
+    [X264_EFFORT_FULL]    = { 11, X264_ME_TESA, 2, 0xffff },
+    [X264_EFFORT_REDUCED] = {  5, X264_ME_HEX,  1, (uint16_t)~X264_ANALYSE_PSUB8x8 },
+    [X264_EFFORT_LOW]     = {  2, X264_ME_DIA,  0, X264_ANALYSE_I8x8|X264_ANALYSE_PSUB16x16 },
+    [X264_EFFORT_MINIMAL] = {  1, X264_ME_DIA,  0, 0 },
+};
+
 static void analyse_update_cache( x264_t *h, x264_mb_analysis_t *a );
 
 static int init_costs( x264_t *h, float *logs, int qp )
@@ -258,7 +278,7 @@ static void mb_analyse_init_qp( x264_t *h, x264_mb_analysis_t *a, int qp )
     a->i_lambda = x264_lambda_tab[qp];
     a->i_lambda2 = x264_lambda2_tab[qp];
 
-    h->mb.b_trellis = h->param.analyse.i_trellis > 1 && a->i_mbrd;
+    h->mb.b_trellis = a->i_trellis > 1 && a->i_mbrd;
     if( h->param.analyse.i_trellis )
     {
         h->mb.i_trellis_lambda2[0][0] = x264_trellis_lambda2_tab[0][qp];
@@ -293,14 +313,27 @@ static void mb_analyse_init_qp( x264_t *h, x264_mb_analysis_t *a, int qp )
 
 static void mb_analyse_init( x264_t *h, x264_mb_analysis_t *a, int qp )
 {
-    int subme = h->param.analyse.i_subpel_refine - (h->sh.i_type == SLICE_TYPE_B);
+    int effort = h->fenc->b_mb_effort ? X264_MIN( h->fenc->mb_effort[h->mb.i_mb_xy], X264_EFFORT_MINIMAL ) : X264_EFFORT_FULL;
+    a->i_subpel_refine = X264_MIN( h->param.analyse.i_subpel_refine, mb_effort_limits[effort].subme );
+    a->i_trellis = X264_MIN( h->param.analyse.i_trellis, mb_effort_limits[effort].trellis );
+    a->i_intra = h->param.analyse.intra & mb_effort_limits[effort].partitions;
+    a->i_inter = h->param.analyse.inter & mb_effort_limits[effort].partitions;
+    if( h->fenc->b_mb_effort )
+    {
+        h->mb.i_me_method = X264_MIN( h->param.analyse.i_me_method, mb_effort_limits[effort].me );
+        h->mb.i_subpel_refine = a->i_subpel_refine;
+        if( h->sh.i_type == SLICE_TYPE_B && (h->mb.i_subpel_refine == 6 || h->mb.i_subpel_refine == 8) )
+            h->mb.i_subpel_refine--;
+    }
+
+    int subme = a->i_subpel_refine - (h->sh.i_type == SLICE_TYPE_B);
 
     /* mbrd == 1 -> RD mode decision */
     /* mbrd == 2 -> RD refinement */
     /* mbrd == 3 -> QPRD */
-    a->i_mbrd = (subme>=6) + (subme>=8) + (h->param.analyse.i_subpel_refine>=10);
-    h->mb.b_deblock_rdo = h->param.analyse.i_subpel_refine >= 9 && h->sh.i_disable_deblocking_filter_idc != 1;
-    a->b_early_terminate = h->param.analyse.i_subpel_refine < 11;
+    a->i_mbrd = (subme>=6) + (subme>=8) + (a->i_subpel_refine>=10);
+    h->mb.b_deblock_rdo = a->i_subpel_refine >= 9 && h->sh.i_disable_deblocking_filter_idc != 1;
+    a->b_early_terminate = a->i_subpel_refine < 11;
 
     mb_analyse_init_qp( h, a, qp );
 
@@ -667,7 +700,7 @@ static void mb_analyse_intra_chroma( x264_t *h, x264_mb_analysis_t *a )
 /* FIXME: should we do any sort of merged chroma analysis with 4:4:4? */
 static void mb_analyse_intra( x264_t *h, x264_mb_analysis_t *a, int i_satd_inter )
 {
-    const unsigned int flags = h->sh.i_type == SLICE_TYPE_I ? h->param.analyse.intra : h->param.analyse.inter;
+    const unsigned int flags = h->sh.i_type == SLICE_TYPE_I ? a->i_intra : a->i_inter;
     pixel *p_src = h->mb.pic.p_fenc[0];
     pixel *p_dst = h->mb.pic.p_fdec[0];
     static const int8_t intra_analysis_shortcut[2][2][2][5] =
@@ -2929,6 +2962,8 @@ void x264_macroblock_analyse( x264_t *h )
     if( h->param.analyse.b_mb_info )
         h->fdec->effective_qp[h->mb.i_mb_xy] = h->mb.i_qp; /* Store the real analysis QP. */
     mb_analyse_init( h, &analysis, h->mb.i_qp );
+    x264_me_subpel_cache_reset( h );
+    h->mb.i_cabac_rd_valid = 0;
 
     /*--------------------------- Do the analysis ---------------------------*/
     if( h->sh.i_type == SLICE_TYPE_I )
@@ -3004,7 +3039,7 @@ intra_analysis:
                 if( skip_invalid )
                     // FIXME don't need to check this if the reference frame is done
                     {}
-                else if( h->param.analyse.i_subpel_refine >= 3 )
+                else if( analysis.i_subpel_refine >= 3 )
                     analysis.b_try_skip = 1;
                 else if( h->mb.i_mb_type_left[0] == P_SKIP ||
                          h->mb.i_mb_type_top == P_SKIP ||
@@ -3028,7 +3063,7 @@ skip_analysis:
         }
         else
         {
-            const unsigned int flags = h->param.analyse.inter;
+            const unsigned int flags = analysis.i_inter;
             int i_type;
             int i_partition;
             int i_satd_inter, i_satd_intra;
@@ -3354,7 +3389,7 @@ skip_analysis:
                 /* Conditioning the probe on neighboring block types
                  * doesn't seem to help speed or quality. */
                 analysis.b_try_skip = x264_macroblock_probe_bskip( h );
-                if( h->param.analyse.i_subpel_refine < 3 )
+                if( analysis.i_subpel_refine < 3 )
                     b_skip = analysis.b_try_skip;
             }
             /* Set up MVs for future predictors */
@@ -3369,7 +3404,7 @@ skip_analysis:
 
         if( !b_skip )
         {
-            const unsigned int flags = h->param.analyse.inter;
+            const unsigned int flags = analysis.i_inter;
             int i_type;
             int i_partition;
             int i_satd_inter;
@@ -3721,10 +3756,10 @@ skip_analysis:
     if( analysis.i_mbrd == 3 && !IS_SKIP(h->mb.i_type) )
         mb_analyse_qp_rd( h, &analysis );
 
-    h->mb.b_trellis = h->param.analyse.i_trellis;
+    h->mb.b_trellis = analysis.i_trellis;
     h->mb.b_noise_reduction = h->mb.b_noise_reduction || (!!h->param.analyse.i_noise_reduction && !IS_INTRA( h->mb.i_type ));
 
-    if( !IS_SKIP(h->mb.i_type) && h->mb.i_psy_trellis && h->param.analyse.i_trellis == 1 )
+    if( !IS_SKIP(h->mb.i_type) && h->mb.i_psy_trellis && analysis.i_trellis == 1 )
         psy_trellis_init( h, 0 );
     if( h->mb.b_trellis == 1 || h->mb.b_noise_reduction )
         h->mb.i_skip_intra = 0;
@@ -866,8 +866,61 @@ void x264_cabac_block_residual_rd_c( x264_t *h, x264_cabac_t *cb, int ctx_block_
     cabac_block_residual_internal( h, cb, ctx_block_cat, l, 0, 0 );
 }
 
+/* Even faster RDO (--fast-rd-rate): cost residuals with the states they had at the start of the mb,
+ * which turns every flag into a table lookup. The tables are rebuilt once per mb and ctx_block_cat,
+ * whereas the full estimate adapts the states after every coded flag. */
+NOINLINE void x264_cabac_rd_table_init( x264_t *h, int ctx_block_cat )
+{
+    x264_cabac_rd_table_t *t = &h->mb.cabac_rd[ctx_block_cat];
+    const uint8_t *state = h->cabac.state;
+    const uint8_t *sig_offset = x264_significant_coeff_flag_offset_8x8[MB_INTERLACED];
+    int ctx_sig = x264_significant_coeff_flag_offset[MB_INTERLACED][ctx_block_cat];
+    int ctx_last = x264_last_coeff_flag_offset[MB_INTERLACED][ctx_block_cat];
+    int ctx_level = x264_coeff_abs_level_m1_offset[ctx_block_cat];
+    int chroma422dc = ctx_block_cat == DCT_CHROMA_DC && CHROMA_FORMAT == CHROMA_422;
+    int count_m1 = chroma422dc ? 7 : x264_count_cat_m1[ctx_block_cat];
+    int b_8x8 = count_m1 == 63;
+    const uint8_t *levelgt1_ctx = chroma422dc ? coeff_abs_levelgt1_ctx_chroma_dc : coeff_abs_levelgt1_ctx;
+
+    for( int i = 0; i < count_m1; i++ )
+    {
+        int sig = state[ctx_sig + (b_8x8 ? sig_offset[i] : chroma422dc ? x264_coeff_flag_offset_chroma_422_dc[i] : i)];
+        int last = state[ctx_last + (b_8x8 ? x264_last_coeff_flag_offset_8x8[i] : chroma422dc ? x264_coeff_flag_offset_chroma_422_dc[i] : i)];
+        t->sig[i][0] = x264_cabac_entropy[sig];
+        t->sig[i][1] = x264_cabac_entropy[sig^1];
+        t->last[i][0] = x264_cabac_entropy[last];
+        t->last[i][1] = x264_cabac_entropy[last^1];
+    }
+    /* neither flag is coded for the last possible position */
+    M32( t->sig[count_m1] ) = 0;
+    M32( t->last[count_m1] ) = 0;
+
+    for( int node_ctx = 0; node_ctx < 8; node_ctx++ )
+    {
+        int level1 = state[ctx_level + coeff_abs_level1_ctx[node_ctx]];
+        int levelgt1 = state[ctx_level + levelgt1_ctx[node_ctx]];
+        t->level[node_ctx][0] = x264_cabac_entropy[level1] + 256; // sign
+        for( int i = 1; i < 15; i++ )
+            t->level[node_ctx][i] = x264_cabac_entropy[level1^1] + x264_cabac_size_unary[i][levelgt1];
+    }
+    h->mb.i_cabac_rd_valid |= 1 << ctx_block_cat;
+}
+
+static ALWAYS_INLINE void cabac_block_residual_fast( x264_t *h, x264_cabac_t *cb, int ctx_block_cat, dctcoef *l )
+{
+    if( !(h->mb.i_cabac_rd_valid & (1 << ctx_block_cat)) )
+        x264_cabac_rd_table_init( h, ctx_block_cat );
+    int last = h->quantf.coeff_last[ctx_block_cat]( l );
+    cb->f8_bits_encoded += h->bsf.cabac_block_residual_bits( l, last, &h->mb.cabac_rd[ctx_block_cat] );
+}
+
 static ALWAYS_INLINE void cabac_block_residual_8x8( x264_t *h, x264_cabac_t *cb, int ctx_block_cat, dctcoef *l )
 {
+    if( h->param.analyse.b_fast_rd_rate )
+    {
+        cabac_block_residual_fast( h, cb, ctx_block_cat, l );
+        return;
+    }
 #if ARCH_X86_64 && HAVE_MMX
     h->bsf.cabac_block_residual_8x8_rd_internal( l, MB_INTERLACED, ctx_block_cat, cb );
 #else
@@ -876,6 +929,11 @@ static ALWAYS_INLINE void cabac_block_residual_8x8( x264_t *h, x264_cabac_t *cb,
 }
 static ALWAYS_INLINE void cabac_block_residual( x264_t *h, x264_cabac_t *cb, int ctx_block_cat, dctcoef *l )
 {
+    if( h->param.analyse.b_fast_rd_rate )
+    {
+        cabac_block_residual_fast( h, cb, ctx_block_cat, l );
+        return;
+    }
 #if ARCH_X86_64 && HAVE_MMX
     h->bsf.cabac_block_residual_rd_internal( l, MB_INTERLACED, ctx_block_cat, cb );
 #else
@@ -885,7 +943,10 @@ static ALWAYS_INLINE void cabac_block_residual( x264_t *h, x264_cabac_t *cb, int
 
 static void cabac_block_residual_422_dc( x264_t *h, x264_cabac_t *cb, int ctx_block_cat, dctcoef *l )
 {
-    cabac_block_residual_internal( h, cb, DCT_CHROMA_DC, l, 0, 1 );
+    if( h->param.analyse.b_fast_rd_rate )
+        cabac_block_residual_fast( h, cb, DCT_CHROMA_DC, l );
+    else
+        cabac_block_residual_internal( h, cb, DCT_CHROMA_DC, l, 0, 1 );
 }
 #endif
 
@@ -30,6 +30,7 @@
 #include "set.h"
 #include "analyse.h"
 #include "ratecontrol.h"
+#include "speed.h"
 #include "macroblock.h"
 #include "me.h"
 #if HAVE_INTEL_DISPATCHER
@@ -48,6 +49,74 @@ static int encoder_frame_end( x264_t *h, x264_t *thread_current,
                               x264_nal_t **pp_nal, int *pi_nal,
                               x264_picture_t *pic_out );
 
+/* With --cabac-thread, the cabac bitstream of a slice is written by a second thread while
+ * the following macroblocks are analysed and encoded, up to MB_WRITER_LAG mbs ahead.
+ * Analysis must not read the cabac states, so RD and trellis are incompatible with it. */
+#define MB_WRITER_LAG 16
+
+/* Everything the entropy coder reads about an mb that changes from one mb to the next.
+ * Only the parts the mb actually codes are copied, see mb_write_copy(). */
+typedef struct
+{
+    ALIGNED_64( dctcoef luma16x16_dc[3][16] );
+    ALIGNED_16( dctcoef chroma_dc[2][8] );
+    ALIGNED_64( dctcoef luma8x8[12][64] );
+    ALIGNED_64( dctcoef luma4x4[16*3][16] );
+    ALIGNED_64( pixel fenc_buf[48*FENC_STRIDE] ); /* I_PCM only */
+
+    ALIGNED_16( int8_t intra4x4_pred_mode[X264_SCAN8_LUMA_SIZE] );
+    ALIGNED_8( uint8_t non_zero_count[X264_SCAN8_SIZE] );
+    ALIGNED_4( int8_t ref[2][X264_SCAN8_LUMA_SIZE] );
+    ALIGNED_16( int16_t mv[2][X264_SCAN8_LUMA_SIZE][2] );
+    ALIGNED_8( uint8_t mvd[2][X264_SCAN8_LUMA_SIZE][2] );
+    ALIGNED_4( int8_t skip[X264_SCAN8_LUMA_SIZE] );
+    int i_neighbour_transform_size;
+    int i_neighbour_skip;
+    int i_cbp_top;
+    int i_cbp_left;
+
+    int i_mb_x;
+    int i_mb_y;
+    int i_mb_xy;
+    int i_mb_prev_xy;
+    int i_mb_top_xy;
+    int i_mb_left_xy[2];
+    int i_mb_top_mbpair_xy;
+    int i_mb_type_top;
+    int i_mb_type_left[2];
+    unsigned int i_neighbour;
+
+    int i_type;
+    int i_partition;
+    ALIGNED_4( uint8_t i_sub_partition[4] );
+    int b_transform_8x8;
+    int i_cbp_luma;
+    int i_cbp_chroma;
+    int i_intra16x16_pred_mode;
+    int i_chroma_pred_mode;
+    int i_qp;
+    int i_last_qp;
+    int i_last_dqp;
+} x264_mb_write_t;
+
+struct x264_mb_writer_t
+{
+    x264_t *h; /* the writer's context, see mb_writer_start */
+    int b_init;
+    x264_pthread_mutex_t mutex;
+    x264_pthread_cond_t  cv;
+    int i_queued;  /* mbs of the slice handed over for writing */
+    int i_written; /* mbs of the slice written */
+    /* Each side sleeps until the other is half a lag further, not one mb, and is only
+     * woken then: 0 if not sleeping. */
+    int i_writer_wake; /* i_queued the writer waits for */
+    int i_queue_wake;  /* i_written analysis waits for */
+    int b_end;     /* no more mbs will be queued */
+    int b_error;
+    x264_mb_write_t mb[MB_WRITER_LAG];
+    int *i_row_bits; /* bits written per mb row, added to the frame's at the end of the slice */
+};
+
 /****************************************************************************
  *
  ******************************* x264 libs **********************************
@@ -938,6 +1007,7 @@ static int validate_parameters( x264_t *h, int b_open )
         h->param.rc.f_pb_factor = 1;
         h->param.analyse.b_psnr = 0;
         h->param.analyse.b_ssim = 0;
+        h->param.analyse.b_vif = 0;
         h->param.analyse.i_chroma_qp_offset = 0;
         h->param.analyse.i_trellis = 0;
         h->param.analyse.b_fast_pskip = 0;
@@ -1061,6 +1131,35 @@ static int validate_parameters( x264_t *h, int b_open )
             h->param.b_pic_struct = 1;
     }
 
+    if( h->param.rc.b_stats_only && (!h->param.rc.b_stat_write || h->param.rc.b_stat_read) )
+    {
+        x264_log( h, X264_LOG_WARNING, "stats-only requires a first pass, ignoring\n" );
+        h->param.rc.b_stats_only = 0;
+    }
+
+    if( h->param.b_cabac_thread )
+    {
+#if !HAVE_THREAD
+        x264_log( h, X264_LOG_WARNING, "cabac-thread: not compiled with thread support, disabling\n" );
+        h->param.b_cabac_thread = 0;
+#else
+        /* The bitstream is written behind analysis, so nothing that needs the size of a
+         * macroblock right after encoding it, or the cabac states it leaves, can be used. */
+        const char *reason = !h->param.b_cabac ? "cavlc" :
+                             h->param.i_slice_max_size ? "slice-max-size" :
+                             h->param.rc.i_vbv_buffer_size ? "vbv" :
+                             PARAM_INTERLACED ? "interlaced" :
+                             h->param.rc.b_stats_only ? "stats-only" :
+                             h->param.analyse.i_subpel_refine >= 6 ? "subme >= 6" :
+                             h->param.analyse.i_trellis ? "trellis" : NULL;
+        if( reason )
+        {
+            x264_log( h, X264_LOG_WARNING, "cabac-thread is incompatible with %s, disabling\n", reason );
+            h->param.b_cabac_thread = 0;
+        }
+#endif
+    }
+
     h->param.i_frame_reference = x264_clip3( h->param.i_frame_reference, 1, X264_REF_MAX );
     h->param.i_dpb_size = x264_clip3( h->param.i_dpb_size, 1, X264_REF_MAX );
     if( h->param.i_scenecut_threshold < 0 )
@@ -1183,6 +1282,7 @@ static int validate_parameters( x264_t *h, int b_open )
     {
         h->param.analyse.b_psnr = 0;
         h->param.analyse.b_ssim = 0;
+        h->param.analyse.b_vif = 0;
     }
     /* Warn users trying to measure PSNR/SSIM with psy opts on. */
     if( b_open && (h->param.analyse.b_psnr || h->param.analyse.b_ssim) )
@@ -1208,6 +1308,22 @@ static int validate_parameters( x264_t *h, int b_open )
             x264_log( h, X264_LOG_WARNING, "--tune %s should be used if attempting to benchmark %s!\n", s, s );
     }
 
+    if( h->param.rc.f_target_ssim > 0 )
+    {
+        if( h->param.rc.i_rc_method != X264_RC_CRF || h->param.rc.b_stat_read )
+        {
+            x264_log( h, X264_LOG_WARNING, "target-ssim requires 1-pass CRF, ignoring\n" );
+            h->param.rc.f_target_ssim = 0;
+        }
+        else
+        {
+            h->param.rc.f_target_ssim = X264_MIN( h->param.rc.f_target_ssim, 0.99999f );
+            h->param.analyse.b_ssim = 1;
+        }
+    }
+    else
+        h->param.rc.f_target_ssim = 0;
+
     if( !h->param.analyse.b_psy )
     {
         h->param.analyse.f_psy_rd = 0;
@@ -1345,6 +1461,8 @@ static int validate_parameters( x264_t *h, int b_open )
         h->param.rc.f_qblur = 0;
     if( h->param.rc.f_complexity_blur < 0 )
         h->param.rc.f_complexity_blur = 0;
+    h->param.sc.f_speed = X264_MAX( h->param.sc.f_speed, 0 );
+    h->param.sc.i_buffer_size = X264_MAX( h->param.sc.i_buffer_size, 1 );
 
     h->param.i_sps_id &= 31;
 
@@ -1373,6 +1491,7 @@ static int validate_parameters( x264_t *h, int b_open )
     BOOLIFY( b_deblocking_filter );
     BOOLIFY( b_deterministic );
     BOOLIFY( b_sliced_threads );
+    BOOLIFY( b_cabac_thread );
     BOOLIFY( b_interlaced );
     BOOLIFY( b_intra_refresh );
     BOOLIFY( b_aud );
@@ -1393,16 +1512,25 @@ static int validate_parameters( x264_t *h, int b_open )
     BOOLIFY( analyse.b_chroma_me );
     BOOLIFY( analyse.b_mixed_references );
     BOOLIFY( analyse.b_fast_pskip );
+    BOOLIFY( analyse.b_fast_rd_rate );
     BOOLIFY( analyse.b_dct_decimate );
+    BOOLIFY( analyse.b_static_detect );
     BOOLIFY( analyse.b_psy );
     BOOLIFY( analyse.b_psnr );
     BOOLIFY( analyse.b_ssim );
+    BOOLIFY( analyse.b_vif );
+    BOOLIFY( analyse.b_mb_stats );
     BOOLIFY( rc.b_stat_write );
+    BOOLIFY( rc.b_stats_only );
     BOOLIFY( rc.b_stat_read );
     BOOLIFY( rc.b_mb_tree );
     BOOLIFY( rc.b_filler );
 #undef BOOLIFY
 
+    /* Static detection hands its results to analysis through mb_info. */
+    if( h->param.analyse.b_static_detect )
+        h->param.analyse.b_mb_info = 1;
+
     return 0;
 }
 
@@ -1740,6 +1868,9 @@ x264_t *x264_encoder_open( x264_param_t *param, void *api )
     if( h->param.i_lookahead_threads > 1 &&
         x264_threadpool_init( &h->lookaheadpool, h->param.i_lookahead_threads ) )
         goto fail;
+    if( h->param.b_cabac_thread &&
+        x264_threadpool_init( &h->writepool, h->param.i_threads ) )
+        goto fail;
 
 #if HAVE_OPENCL
     if( h->param.b_opencl )
@@ -1792,6 +1923,19 @@ x264_t *x264_encoder_open( x264_param_t *param, void *api )
 
         if( allocate_threadlocal_data && x264_macroblock_cache_allocate( h->thread[i] ) < 0 )
             goto fail;
+
+        if( h->param.b_cabac_thread )
+        {
+            x264_mb_writer_t *w;
+            CHECKED_MALLOCZERO( w, sizeof(x264_mb_writer_t) );
+            h->thread[i]->mb_writer = w;
+            CHECKED_MALLOC( w->h, sizeof(x264_t) );
+            CHECKED_MALLOC( w->i_row_bits, h->mb.i_mb_height * sizeof(int) );
+            if( x264_pthread_mutex_init( &w->mutex, NULL ) )
+                goto fail;
+            if( x264_pthread_cond_init( &w->cv, NULL ) )
+                goto fail;
+        }
     }
 
 #if HAVE_OPENCL
@@ -1809,6 +1953,9 @@ x264_t *x264_encoder_open( x264_param_t *param, void *api )
     if( x264_ratecontrol_new( h ) < 0 )
         goto fail;
 
+    if( h->param.sc.f_speed > 0 && x264_speedcontrol_new( h ) < 0 )
+        goto fail;
+
     if( h->param.i_nal_hrd )
     {
         x264_log( h, X264_LOG_DEBUG, "HRD bitrate: %i bits/sec\n", h->sps->vui.hrd.i_bit_rate_unscaled );
@@ -1889,6 +2036,7 @@ static int encoder_try_reconfig( x264_t *h, x264_param_t *param, int *rc_reconfi
     COPY( analyse.b_chroma_me );
     COPY( analyse.b_dct_decimate );
     COPY( analyse.b_fast_pskip );
+    COPY( analyse.b_fast_rd_rate );
     COPY( analyse.b_mixed_references );
     COPY( analyse.f_psy_rd );
     COPY( analyse.f_psy_trellis );
@@ -2410,6 +2558,123 @@ static inline void reference_build_list( x264_t *h, int i_poc )
     h->mb.pic.i_fref[1] = h->i_ref[1];
 }
 
+/* Flag the mb columns of the hpel band above mb row mb_y whose pixels, including the support
+ * of the 6-tap filter, are bit-identical to the first reference: the mb and its horizontal
+ * neighbours in both rows the band spans are P_SKIP with a zero mv and no deblocked edges.
+ * Returns the number of flagged columns. */
+static int fdec_hpel_static( x264_t *h, int mb_y )
+{
+    int b_deblock = h->sh.i_disable_deblocking_filter_idc != 1;
+    uint8_t *col = h->hpel_static;
+    int count = 0;
+
+    for( int x = 0; x < h->mb.i_mb_width; x++ )
+    {
+        col[x] = 1;
+        for( int y = X264_MAX( mb_y-2, 0 ); y < mb_y; y++ )
+        {
+            int mb_xy = y*h->mb.i_mb_stride + x;
+            uint8_t (*bs)[8][4] = h->deblock_strength[y&1][h->param.b_sliced_threads?mb_xy:x];
+            col[x] &= h->mb.type[mb_xy] == P_SKIP && !M32( h->fdec->mv[0][4*(y*h->mb.i_b4_stride + x)] );
+            if( b_deblock )
+                col[x] &= !(M64( bs[0][0] ) | M64( bs[0][2] ) | M64( bs[1][0] ) | M64( bs[1][2] ));
+        }
+    }
+    for( int x = 0, prev = col[0]; x < h->mb.i_mb_width; x++ )
+    {
+        int cur = col[x];
+        int next = x+1 < h->mb.i_mb_width ? col[x+1] : cur;
+        col[x] = prev & cur & next;
+        count += col[x];
+        prev = cur;
+    }
+    return count;
+}
+
+/* Accumulate psnr/ssim of the rows that fdec_filter_row has just finalised. */
+static void fdec_measure_row( x264_t *h, int minpix_y, int maxpix_y, int b_start )
+{
+    maxpix_y = X264_MIN( maxpix_y, h->param.i_height );
+    if( h->param.analyse.b_psnr )
+    {
+        for( int p = 0; p < (CHROMA444 ? 3 : 1); p++ )
+            h->stat.frame.i_ssd[p] += x264_pixel_ssd_wxh( &h->pixf,
+                h->fdec->plane[p] + minpix_y * h->fdec->i_stride[p], h->fdec->i_stride[p],
+                h->fenc->plane[p] + minpix_y * h->fenc->i_stride[p], h->fenc->i_stride[p],
+                h->param.i_width, maxpix_y-minpix_y );
+        if( !CHROMA444 )
+        {
+            uint64_t ssd_u, ssd_v;
+            int v_shift = CHROMA_V_SHIFT;
+            x264_pixel_ssd_nv12( &h->pixf,
+                h->fdec->plane[1] + (minpix_y>>v_shift) * h->fdec->i_stride[1], h->fdec->i_stride[1],
+                h->fenc->plane[1] + (minpix_y>>v_shift) * h->fenc->i_stride[1], h->fenc->i_stride[1],
+                h->param.i_width>>1, (maxpix_y-minpix_y)>>v_shift, &ssd_u, &ssd_v );
+            h->stat.frame.i_ssd[1] += ssd_u;
+            h->stat.frame.i_ssd[2] += ssd_v;
+        }
+    }
+
+    if( h->param.analyse.b_ssim )
+    {
+        int ssim_cnt;
+        x264_emms();
+        /* offset by 2 pixels to avoid alignment of ssim blocks with dct blocks,
+         * and overlap by 4, whose sums are carried over from the previous band */
+        minpix_y += b_start ? 2 : -6;
+        h->stat.frame.f_ssim +=
+            x264_pixel_ssim_rows( &h->pixf,
+                h->fdec->plane[0] + 2+minpix_y*h->fdec->i_stride[0], h->fdec->i_stride[0],
+                h->fenc->plane[0] + 2+minpix_y*h->fenc->i_stride[0], h->fenc->i_stride[0],
+                h->param.i_width-2, maxpix_y-minpix_y, h->ssim_sums, &ssim_cnt, !b_start );
+        h->stat.frame.i_ssim_cnt += ssim_cnt;
+    }
+}
+
+/* Per-mb ssd and ssim of a finished mb row, for analyse.b_mb_stats. */
+static void fdec_mb_stats_row( x264_t *h, int mb_y )
+{
+    ALIGNED_ARRAY_16( int, ssim_buf,[2*(16/4+3)],[4] );
+    int y = mb_y * 16;
+    int height = x264_clip3( h->param.i_height - y, 0, 16 );
+    for( int mb_x = 0; mb_x < h->mb.i_mb_width; mb_x++ )
+    {
+        int mb_xy = mb_x + mb_y * h->mb.i_mb_stride;
+        int x = mb_x * 16;
+        int width = X264_MIN( h->param.i_width - x, 16 );
+        uint64_t ssd = 0;
+        float ssim = 1.0f;
+        if( height > 0 )
+        {
+            for( int p = 0; p < (CHROMA444 ? 3 : 1); p++ )
+                ssd += x264_pixel_ssd_wxh( &h->pixf,
+                    h->fdec->plane[p] + y * h->fdec->i_stride[p] + x, h->fdec->i_stride[p],
+                    h->fenc->plane[p] + y * h->fenc->i_stride[p] + x, h->fenc->i_stride[p],
+                    width, height );
+            if( CHROMA_FORMAT == CHROMA_420 || CHROMA_FORMAT == CHROMA_422 )
+            {
+                uint64_t ssd_u, ssd_v;
+                int v_shift = CHROMA_V_SHIFT;
+                x264_pixel_ssd_nv12( &h->pixf,
+                    h->fdec->plane[1] + (y>>v_shift) * h->fdec->i_stride[1] + x, h->fdec->i_stride[1],
+                    h->fenc->plane[1] + (y>>v_shift) * h->fenc->i_stride[1] + x, h->fenc->i_stride[1],
+                    (width+1)>>1, (height+v_shift)>>v_shift, &ssd_u, &ssd_v );
+                ssd += ssd_u + ssd_v;
+            }
+            int cnt;
+            x264_emms();
+            float sum = x264_pixel_ssim_wxh( &h->pixf,
+                h->fdec->plane[0] + y * h->fdec->i_stride[0] + x, h->fdec->i_stride[0],
+                h->fenc->plane[0] + y * h->fenc->i_stride[0] + x, h->fenc->i_stride[0],
+                width, height, ssim_buf, &cnt );
+            if( cnt > 0 )
+                ssim = sum / cnt;
+        }
+        h->mb.ssd[mb_xy] = X264_MIN( ssd, UINT32_MAX );
+        h->mb.ssim[mb_xy] = ssim;
+    }
+}
+
 static void fdec_filter_row( x264_t *h, int mb_y, int pass )
 {
     /* mb_y is the mb to be encoded next, not the mb to be filtered here */
@@ -2423,7 +2688,7 @@ static void fdec_filter_row( x264_t *h, int mb_y, int pass )
      * above each MB, as bS=4 doesn't happen for the top of interlaced mbpairs. */
     int minpix_y = min_y*16 - 4 * !b_start;
     int maxpix_y = mb_y*16 - 4 * !b_end;
-    b_deblock &= b_hpel || h->param.b_full_recon || h->param.psz_dump_yuv;
+    b_deblock &= b_hpel || h->param.b_full_recon || h->param.psz_dump_yuv || h->param.analyse.b_mb_stats;
     if( h->param.b_sliced_threads )
     {
         switch( pass )
@@ -2475,7 +2740,16 @@ static void fdec_filter_row( x264_t *h, int mb_y, int pass )
         /* Can't do hpel until the previous slice is done encoding. */
         if( h->param.analyse.i_subpel_refine )
         {
-            x264_frame_filter( h, h->fdec, min_y, end );
+            /* In static areas, reuse the reference's filtered pixels instead of recomputing them. */
+            x264_frame_t *ref = NULL;
+            if( h->sh.i_type == SLICE_TYPE_P && !PARAM_INTERLACED && !h->sh.weight[0][0].weightfn &&
+                !h->sh.weight[0][1].weightfn && !h->sh.weight[0][2].weightfn && fdec_hpel_static( h, mb_y ) )
+            {
+                ref = h->fref[0][0];
+                if( h->i_thread_frames > 1 )
+                    x264_frame_cond_wait( ref->orig, mb_y*16 + (end ? 10000 : 0) );
+            }
+            x264_frame_filter( h, h->fdec, min_y, end, ref, h->hpel_static );
             x264_frame_expand_border_filtered( h, h->fdec, min_y, end );
         }
     }
@@ -2490,42 +2764,19 @@ static void fdec_filter_row( x264_t *h, int mb_y, int pass )
     if( h->i_thread_frames > 1 && h->fdec->b_kept_as_ref )
         x264_frame_cond_broadcast( h->fdec, mb_y*16 + (b_end ? 10000 : -(X264_THREAD_HEIGHT << SLICE_MBAFF)) );
 
+    /* Measure only once the rows are released to the other frame threads, which may be waiting on them. */
     if( b_measure_quality )
     {
-        maxpix_y = X264_MIN( maxpix_y, h->param.i_height );
-        if( h->param.analyse.b_psnr )
+        fdec_measure_row( h, minpix_y, maxpix_y, b_start );
+        /* The mb rows that this band finishes. */
+        for( int y = minpix_y >> 4; y < maxpix_y >> 4; y++ )
         {
-            for( int p = 0; p < (CHROMA444 ? 3 : 1); p++ )
-                h->stat.frame.i_ssd[p] += x264_pixel_ssd_wxh( &h->pixf,
-                    h->fdec->plane[p] + minpix_y * h->fdec->i_stride[p], h->fdec->i_stride[p],
-                    h->fenc->plane[p] + minpix_y * h->fenc->i_stride[p], h->fenc->i_stride[p],
-                    h->param.i_width, maxpix_y-minpix_y );
-            if( !CHROMA444 )
-            {
-                uint64_t ssd_u, ssd_v;
-                int v_shift = CHROMA_V_SHIFT;
-                x264_pixel_ssd_nv12( &h->pixf,
-                    h->fdec->plane[1] + (minpix_y>>v_shift) * h->fdec->i_stride[1], h->fdec->i_stride[1],
-                    h->fenc->plane[1] + (minpix_y>>v_shift) * h->fenc->i_stride[1], h->fenc->i_stride[1],
-                    h->param.i_width>>1, (maxpix_y-minpix_y)>>v_shift, &ssd_u, &ssd_v );
-                h->stat.frame.i_ssd[1] += ssd_u;
-                h->stat.frame.i_ssd[2] += ssd_v;
-            }
-        }
-
-        if( h->param.analyse.b_ssim )
-        {
-            int ssim_cnt;
-            x264_emms();
-            /* offset by 2 pixels to avoid alignment of ssim blocks with dct blocks,
-             * and overlap by 4 */
-            minpix_y += b_start ? 2 : -6;
-            h->stat.frame.f_ssim +=
-                x264_pixel_ssim_wxh( &h->pixf,
-                    h->fdec->plane[0] + 2+minpix_y*h->fdec->i_stride[0], h->fdec->i_stride[0],
-                    h->fenc->plane[0] + 2+minpix_y*h->fenc->i_stride[0], h->fenc->i_stride[0],
-                    h->param.i_width-2, maxpix_y-minpix_y, h->scratch_buffer, &ssim_cnt );
-            h->stat.frame.i_ssim_cnt += ssim_cnt;
+            if( h->param.analyse.b_mb_stats )
+                fdec_mb_stats_row( h, y );
+            if( h->param.analyse.b_vif && y*16 < h->param.i_height )
+                x264_pixel_vif_wxh( h->fenc->plane[0] + y*16 * h->fenc->i_stride[0], h->fenc->i_stride[0],
+                                    h->fdec->plane[0] + y*16 * h->fdec->i_stride[0], h->fdec->i_stride[0],
+                                    h->param.i_width, X264_MIN( 16, h->param.i_height - y*16 ), h->stat.frame.f_vif );
         }
     }
 }
@@ -2699,6 +2950,7 @@ static ALWAYS_INLINE void bitstream_backup( x264_t *h, x264_bs_bak_t *bak, int i
     {
         bak->stat.i_mv_bits = h->stat.frame.i_mv_bits;
         bak->stat.i_tex_bits = h->stat.frame.i_tex_bits;
+        bak->stat.i_sized_bits = h->stat.frame.i_sized_bits;
     }
     /* In the per-MB backup, we don't need the contexts because flushing the CABAC
      * encoder has no context dependency and in this case, a slice is ended (and
@@ -2733,6 +2985,7 @@ static ALWAYS_INLINE void bitstream_restore( x264_t *h, x264_bs_bak_t *bak, int
     {
         h->stat.frame.i_mv_bits = bak->stat.i_mv_bits;
         h->stat.frame.i_tex_bits = bak->stat.i_tex_bits;
+        h->stat.frame.i_sized_bits = bak->stat.i_sized_bits;
     }
     if( h->param.b_cabac )
     {
@@ -2749,6 +3002,248 @@ static ALWAYS_INLINE void bitstream_restore( x264_t *h, x264_bs_bak_t *bak, int
     }
 }
 
+#define MB_COPY( a, b, size ) memcpy( b_load ? (void*)(a) : (void*)(b), b_load ? (void*)(b) : (void*)(a), size )
+#define MB_COPY_BLOCK( a, b ) MB_COPY( a, b, sizeof(a) )
+#define MB_COPY_VAR( a, b ) if( b_load ) a = b; else b = a
+
+/* Copy the state the entropy coder needs for the current mb from h to mb (or, with b_load, back).
+ * Coefficient blocks are only read if coded, and cache entries only by mb types that code them,
+ * so the rest is left out. */
+static void mb_write_copy( x264_t *h, x264_mb_write_t *mb, int b_load )
+{
+    MB_COPY_VAR( h->mb.i_mb_x, mb->i_mb_x );
+    MB_COPY_VAR( h->mb.i_mb_y, mb->i_mb_y );
+    MB_COPY_VAR( h->mb.i_mb_xy, mb->i_mb_xy );
+    MB_COPY_VAR( h->mb.i_mb_prev_xy, mb->i_mb_prev_xy );
+    MB_COPY_VAR( h->mb.i_mb_top_xy, mb->i_mb_top_xy );
+    MB_COPY_VAR( h->mb.i_mb_left_xy[0], mb->i_mb_left_xy[0] );
+    MB_COPY_VAR( h->mb.i_mb_left_xy[1], mb->i_mb_left_xy[1] );
+    MB_COPY_VAR( h->mb.i_mb_top_mbpair_xy, mb->i_mb_top_mbpair_xy );
+    MB_COPY_VAR( h->mb.i_mb_type_top, mb->i_mb_type_top );
+    MB_COPY_VAR( h->mb.i_mb_type_left[0], mb->i_mb_type_left[0] );
+    MB_COPY_VAR( h->mb.i_mb_type_left[1], mb->i_mb_type_left[1] );
+    MB_COPY_VAR( h->mb.i_neighbour, mb->i_neighbour );
+    MB_COPY_VAR( h->mb.i_type, mb->i_type );
+    MB_COPY_VAR( h->mb.i_partition, mb->i_partition );
+    MB_COPY_BLOCK( h->mb.i_sub_partition, mb->i_sub_partition );
+    MB_COPY_VAR( h->mb.b_transform_8x8, mb->b_transform_8x8 );
+    MB_COPY_VAR( h->mb.i_cbp_luma, mb->i_cbp_luma );
+    MB_COPY_VAR( h->mb.i_cbp_chroma, mb->i_cbp_chroma );
+    MB_COPY_VAR( h->mb.i_intra16x16_pred_mode, mb->i_intra16x16_pred_mode );
+    MB_COPY_VAR( h->mb.i_chroma_pred_mode, mb->i_chroma_pred_mode );
+    MB_COPY_VAR( h->mb.i_qp, mb->i_qp );
+    MB_COPY_VAR( h->mb.i_last_qp, mb->i_last_qp );
+    MB_COPY_VAR( h->mb.i_last_dqp, mb->i_last_dqp );
+    MB_COPY_VAR( h->mb.cache.i_neighbour_skip, mb->i_neighbour_skip );
+
+    int i_type = h->mb.i_type;
+    if( IS_SKIP( i_type ) )
+        return;
+    if( i_type == I_PCM )
+    {
+        MB_COPY_BLOCK( h->mb.pic.fenc_buf, mb->fenc_buf );
+        return;
+    }
+
+    MB_COPY_VAR( h->mb.cache.i_neighbour_transform_size, mb->i_neighbour_transform_size );
+    MB_COPY_VAR( h->mb.cache.i_cbp_top, mb->i_cbp_top );
+    MB_COPY_VAR( h->mb.cache.i_cbp_left, mb->i_cbp_left );
+    MB_COPY_BLOCK( h->mb.cache.non_zero_count, mb->non_zero_count );
+    if( i_type == I_4x4 || i_type == I_8x8 )
+        MB_COPY_BLOCK( h->mb.cache.intra4x4_pred_mode, mb->intra4x4_pred_mode );
+    else if( !IS_INTRA( i_type ) )
+    {
+        int i_lists = h->sh.i_type == SLICE_TYPE_B ? 2 : 1;
+        MB_COPY( h->mb.cache.ref, mb->ref, i_lists * sizeof(mb->ref[0]) );
+        MB_COPY( h->mb.cache.mv, mb->mv, i_lists * sizeof(mb->mv[0]) );
+        MB_COPY( h->mb.cache.mvd, mb->mvd, i_lists * sizeof(mb->mvd[0]) );
+        if( i_lists == 2 )
+            MB_COPY_BLOCK( h->mb.cache.skip, mb->skip );
+    }
+
+    /* Coefficients, as x264_macroblock_write_cabac reads them: by cbp, then coded_block_flag. */
+    uint8_t *nnz = h->mb.cache.non_zero_count;
+    int plane_count = CHROMA444 ? 3 : 1;
+    for( int p = 0; p < plane_count; p++ )
+    {
+        if( i_type == I_16x16 )
+        {
+            if( nnz[x264_scan8[LUMA_DC+p]] )
+                MB_COPY_BLOCK( h->dct.luma16x16_dc[p], mb->luma16x16_dc[p] );
+            if( h->mb.i_cbp_luma )
+                for( int i = p*16; i < p*16+16; i++ )
+                    if( nnz[x264_scan8[i]] )
+                        MB_COPY_BLOCK( h->dct.luma4x4[i], mb->luma4x4[i] );
+        }
+        else
+            for( int i8 = 0; i8 < 4; i8++ )
+            {
+                if( !(h->mb.i_cbp_luma & (1 << i8)) )
+                    continue;
+                if( h->mb.b_transform_8x8 )
+                    MB_COPY_BLOCK( h->dct.luma8x8[i8+p*4], mb->luma8x8[i8+p*4] );
+                else
+                    for( int i = p*16+i8*4; i < p*16+i8*4+4; i++ )
+                        if( nnz[x264_scan8[i]] )
+                            MB_COPY_BLOCK( h->dct.luma4x4[i], mb->luma4x4[i] );
+            }
+    }
+    if( CHROMA_FORMAT && !CHROMA444 && h->mb.i_cbp_chroma )
+    {
+        for( int ch = 0; ch < 2; ch++ )
+            if( nnz[x264_scan8[CHROMA_DC+ch]] )
+                MB_COPY_BLOCK( h->dct.chroma_dc[ch], mb->chroma_dc[ch] );
+        if( h->mb.i_cbp_chroma == 2 )
+        {
+            int step = 8 << CHROMA_V_SHIFT;
+            for( int i = 16; i < 3*16; i += step )
+                for( int j = i; j < i+4; j++ )
+                    if( nnz[x264_scan8[j]] )
+                        MB_COPY_BLOCK( h->dct.luma4x4[j], mb->luma4x4[j] );
+        }
+    }
+}
+
+#undef MB_COPY
+#undef MB_COPY_BLOCK
+#undef MB_COPY_VAR
+
+static void *mb_writer_thread( x264_mb_writer_t *w )
+{
+    x264_t *h = w->h;
+    for( int i = 0;; i++ )
+    {
+        x264_pthread_mutex_lock( &w->mutex );
+        if( w->i_queued <= i && !w->b_end )
+        {
+            w->i_writer_wake = i + MB_WRITER_LAG/2;
+            while( w->i_queued < w->i_writer_wake && !w->b_end )
+                x264_pthread_cond_wait( &w->cv, &w->mutex );
+            w->i_writer_wake = 0;
+        }
+        int b_done = w->i_queued <= i;
+        x264_pthread_mutex_unlock( &w->mutex );
+        if( b_done )
+            break;
+
+        mb_write_copy( h, &w->mb[i%MB_WRITER_LAG], 1 );
+
+        /* After an error, keep consuming mbs so that analysis doesn't wait forever. */
+        if( !w->b_error && h->mb.i_mb_x == 0 && bitstream_check_buffer( h ) )
+            w->b_error = 1;
+        if( !w->b_error )
+        {
+            int mb_spos = x264_cabac_pos( &h->cabac );
+            if( i > 0 )
+                x264_cabac_encode_terminal( &h->cabac );
+            if( IS_SKIP( h->mb.i_type ) )
+                x264_cabac_mb_skip( h, 1 );
+            else
+            {
+                if( h->sh.i_type != SLICE_TYPE_I )
+                    x264_cabac_mb_skip( h, 0 );
+                x264_macroblock_write_cabac( h, &h->cabac );
+            }
+            w->i_row_bits[h->mb.i_mb_y] += x264_cabac_pos( &h->cabac ) - mb_spos;
+        }
+
+        x264_pthread_mutex_lock( &w->mutex );
+        w->i_written = i+1;
+        if( w->i_queue_wake && w->i_written >= w->i_queue_wake )
+            x264_pthread_cond_broadcast( &w->cv );
+        x264_pthread_mutex_unlock( &w->mutex );
+    }
+    return NULL;
+}
+
+/* The writer's context is a copy of the thread's made on first use. After that only what
+ * the entropy coder reads and can change between slices is brought over. */
+static void mb_writer_start( x264_t *h, x264_mb_writer_t *w )
+{
+    x264_t *wh = w->h;
+    if( !w->b_init )
+    {
+        *wh = *h;
+        x264_macroblock_thread_init( wh );
+        w->b_init = 1;
+    }
+    wh->sh = h->sh;
+    wh->out = h->out;
+    wh->cabac = h->cabac;
+    wh->stat.frame.i_mv_bits = h->stat.frame.i_mv_bits;
+    wh->stat.frame.i_tex_bits = h->stat.frame.i_tex_bits;
+    memcpy( wh->mb.pic.i_fref, h->mb.pic.i_fref, sizeof(wh->mb.pic.i_fref) );
+    /* Sliced threads use the first thread's neighbour arrays. */
+    wh->mb.type = h->mb.type;
+    wh->mb.cbp = h->mb.cbp;
+    wh->mb.mb_transform_size = h->mb.mb_transform_size;
+    wh->mb.chroma_pred_mode = h->mb.chroma_pred_mode;
+    wh->mb.slice_table = h->mb.slice_table;
+    wh->mb.field = h->mb.field;
+    w->i_queued = 0;
+    w->i_written = 0;
+    w->i_writer_wake = 0;
+    w->i_queue_wake = 0;
+    w->b_end = 0;
+    w->b_error = 0;
+    memset( w->i_row_bits, 0, h->mb.i_mb_height * sizeof(int) );
+    x264_threadpool_run( h->writepool, (void*)mb_writer_thread, w );
+}
+
+/* Wait until the writer has a free slot for mb i of the slice. */
+static void mb_writer_wait( x264_mb_writer_t *w, int i )
+{
+    if( i < MB_WRITER_LAG )
+        return;
+    x264_pthread_mutex_lock( &w->mutex );
+    if( w->i_written <= i - MB_WRITER_LAG )
+    {
+        w->i_queue_wake = i - MB_WRITER_LAG/2 + 1;
+        while( w->i_written < w->i_queue_wake )
+            x264_pthread_cond_wait( &w->cv, &w->mutex );
+        w->i_queue_wake = 0;
+    }
+    x264_pthread_mutex_unlock( &w->mutex );
+}
+
+static void mb_writer_queue( x264_t *h, x264_mb_writer_t *w, int i )
+{
+    /* Writing the qp delta can lower the qp of an empty I_16x16, which has to
+     * be known before the mb is saved for deblocking and the next mb's qp. */
+    if( h->mb.i_type == I_16x16 && !h->mb.cbp[h->mb.i_mb_xy] && h->mb.i_qp > h->mb.i_last_qp )
+        h->mb.i_qp = h->mb.i_last_qp;
+    /* The mvds are used as context by the following mbs. */
+    if( (0x3FF30 >> h->mb.i_type) & 1 ) /* !INTRA && !SKIP && !DIRECT */
+        x264_macroblock_cabac_mvd( h );
+
+    mb_write_copy( h, &w->mb[i%MB_WRITER_LAG], 0 );
+
+    x264_pthread_mutex_lock( &w->mutex );
+    w->i_queued = i+1;
+    if( w->i_writer_wake && w->i_queued >= w->i_writer_wake )
+        x264_pthread_cond_broadcast( &w->cv );
+    x264_pthread_mutex_unlock( &w->mutex );
+}
+
+/* Wait for the writer to finish the slice and take over its bitstream state. */
+static int mb_writer_finish( x264_t *h, x264_mb_writer_t *w )
+{
+    x264_pthread_mutex_lock( &w->mutex );
+    w->b_end = 1;
+    x264_pthread_cond_broadcast( &w->cv );
+    x264_pthread_mutex_unlock( &w->mutex );
+    x264_threadpool_wait( h->writepool, w );
+
+    /* The output buffer may have been reallocated by the writer. */
+    h->out = w->h->out;
+    h->cabac = w->h->cabac;
+    h->stat.frame.i_mv_bits = w->h->stat.frame.i_mv_bits;
+    h->stat.frame.i_tex_bits = w->h->stat.frame.i_tex_bits;
+    for( int y = h->i_threadslice_start; y < h->i_threadslice_end; y++ )
+        h->fdec->i_row_bits[y] += w->i_row_bits[y];
+    return w->b_error ? -1 : 0;
+}
+
 static intptr_t slice_write( x264_t *h )
 {
     int i_skip;
@@ -2766,13 +3261,17 @@ static intptr_t slice_write( x264_t *h )
     int b_hpel = h->fdec->b_kept_as_ref;
     int orig_last_mb = h->sh.i_last_mb;
     int thread_last_mb = h->i_threadslice_end * h->mb.i_mb_width - 1;
+    x264_mb_writer_t *writer = h->param.b_cabac_thread ? h->mb_writer : NULL;
+    /* CAVLC is cheap enough to write even when only the stats are wanted. */
+    int b_size_only = h->param.rc.b_stats_only && h->param.b_cabac;
+    int i_mb = 0;
     uint8_t *last_emu_check;
 #define BS_BAK_SLICE_MAX_SIZE 0
 #define BS_BAK_CAVLC_OVERFLOW 1
 #define BS_BAK_SLICE_MIN_MBS  2
 #define BS_BAK_ROW_VBV        3
     x264_bs_bak_t bs_bak[4];
-    b_deblock &= b_hpel || h->param.b_full_recon || h->param.psz_dump_yuv;
+    b_deblock &= b_hpel || h->param.b_full_recon || h->param.psz_dump_yuv || h->param.analyse.b_mb_stats;
     bs_realign( &h->out.bs );
 
     /* Slice */
@@ -2797,6 +3296,7 @@ static intptr_t slice_write( x264_t *h )
         /* init cabac */
         x264_cabac_context_init( h, &h->cabac, h->sh.i_type, x264_clip3( h->sh.i_qp-QP_BD_OFFSET, 0, 51 ), h->sh.i_cabac_init_idc );
         x264_cabac_encode_init ( &h->cabac, h->out.bs.p, h->out.bs.p_end );
+        h->cabac.f8_bits_encoded = 0; /* fraction of a bit carried by stats-only sizing */
         last_emu_check = h->cabac.p;
     }
     else
@@ -2805,6 +3305,9 @@ static intptr_t slice_write( x264_t *h )
     h->mb.i_last_dqp = 0;
     h->mb.field_decoding_flag = 0;
 
+    if( writer )
+        mb_writer_start( h, writer );
+
     i_mb_y = h->sh.i_first_mb / h->mb.i_mb_width;
     i_mb_x = h->sh.i_first_mb % h->mb.i_mb_width;
     i_skip = 0;
@@ -2812,11 +3315,11 @@ static intptr_t slice_write( x264_t *h )
     while( 1 )
     {
         mb_xy = i_mb_x + i_mb_y * h->mb.i_mb_width;
-        int mb_spos = bs_pos(&h->out.bs) + x264_cabac_pos(&h->cabac);
+        int mb_spos = bs_pos(&h->out.bs) + x264_cabac_pos(&h->cabac) + h->stat.frame.i_sized_bits;
 
         if( i_mb_x == 0 )
         {
-            if( bitstream_check_buffer( h ) )
+            if( !writer && bitstream_check_buffer( h ) )
                 return -1;
             if( !(i_mb_y & SLICE_MBAFF) && h->param.rc.i_vbv_buffer_size )
                 bitstream_backup( h, &bs_bak[BS_BAK_ROW_VBV], i_skip, 1 );
@@ -2858,13 +3361,20 @@ static intptr_t slice_write( x264_t *h )
         else
             x264_macroblock_cache_load_progressive( h, i_mb_x, i_mb_y );
 
+        if( writer )
+            mb_writer_wait( writer, i_mb );
+
         x264_macroblock_analyse( h );
 
         /* encode this macroblock -> be careful it can change the mb type to P_SKIP if needed */
 reencode:
         x264_macroblock_encode( h );
 
-        if( h->param.b_cabac )
+        if( writer )
+            mb_writer_queue( h, writer, i_mb++ );
+        else if( b_size_only )
+            x264_macroblock_size_stats( h );
+        else if( h->param.b_cabac )
         {
             if( mb_xy > h->sh.i_first_mb && !(SLICE_MBAFF && (i_mb_y&1)) )
                 x264_cabac_encode_terminal( &h->cabac );
@@ -2903,8 +3413,9 @@ reencode:
             }
         }
 
-        int total_bits = bs_pos(&h->out.bs) + x264_cabac_pos(&h->cabac);
-        int mb_size = total_bits - mb_spos;
+        int total_bits = bs_pos(&h->out.bs) + x264_cabac_pos(&h->cabac) + h->stat.frame.i_sized_bits;
+        /* The writer counts the bits of the mbs it writes itself, see mb_writer_finish. */
+        int mb_size = writer ? 0 : total_bits - mb_spos;
 
         if( slice_max_size && (!SLICE_MBAFF || (i_mb_y&1)) )
         {
@@ -3072,6 +3583,9 @@ cont:
             i_mb_x = 0;
         }
     }
+    if( writer && mb_writer_finish( h, writer ) < 0 )
+        return -1;
+
     if( h->sh.i_last_mb < h->sh.i_first_mb )
         return 0;
 
@@ -3095,7 +3609,7 @@ cont:
 
     if( h->sh.i_last_mb == (h->i_threadslice_end * h->mb.i_mb_width - 1) )
     {
-        h->stat.frame.i_misc_bits = bs_pos( &h->out.bs )
+        h->stat.frame.i_misc_bits = bs_pos( &h->out.bs ) + h->stat.frame.i_sized_bits
                                   + (h->out.i_nal*NALU_OVERHEAD * 8)
                                   - h->stat.frame.i_tex_bits
                                   - h->stat.frame.i_mv_bits;
@@ -3265,13 +3779,15 @@ static int threaded_slices_write( x264_t *h )
             h->out.i_nal++;
             nal_check_buffer( h );
         }
-        /* All entries in stat.frame are ints except for ssd/ssim. */
+        /* All entries in stat.frame are ints except for ssd/ssim/vif. */
         for( size_t j = 0; j < (offsetof(x264_t,stat.frame.i_ssd) - offsetof(x264_t,stat.frame.i_mv_bits)) / sizeof(int); j++ )
             ((int*)&h->stat.frame)[j] += ((int*)&t->stat.frame)[j];
         for( int j = 0; j < 3; j++ )
             h->stat.frame.i_ssd[j] += t->stat.frame.i_ssd[j];
         h->stat.frame.f_ssim += t->stat.frame.f_ssim;
         h->stat.frame.i_ssim_cnt += t->stat.frame.i_ssim_cnt;
+        h->stat.frame.f_vif[0] += t->stat.frame.f_vif[0];
+        h->stat.frame.f_vif[1] += t->stat.frame.f_vif[1];
     }
 
     return 0;
@@ -3419,6 +3935,12 @@ int     x264_encoder_encode( x264_t *h,
         if( pic_in->prop.quant_offsets_free )
             pic_in->prop.quant_offsets_free( pic_in->prop.quant_offsets );
 
+        fenc->b_mb_effort = !!pic_in->prop.mb_effort;
+        if( fenc->b_mb_effort )
+            memcpy( fenc->mb_effort, pic_in->prop.mb_effort, h->mb.i_mb_count * sizeof(uint8_t) );
+        if( pic_in->prop.mb_effort_free )
+            pic_in->prop.mb_effort_free( pic_in->prop.mb_effort );
+
         if( h->frames.b_have_lowres )
             x264_frame_init_lowres( h, fenc );
 
@@ -3476,6 +3998,8 @@ int     x264_encoder_encode( x264_t *h,
         }
     }
     x264_ratecontrol_zone_init( h );
+    if( h->sc )
+        x264_speedcontrol_frame( h );
 
     // ok to call this before encoding any frames, since the initial values of fdec have b_kept_as_ref=0
     if( reference_update( h ) )
@@ -3943,6 +4467,7 @@ static int encoder_frame_end( x264_t *h, x264_t *thread_current,
     int frame_size = encoder_encapsulate_nals( h, 0 );
     if( frame_size < 0 )
         return -1;
+    frame_size += (h->stat.frame.i_sized_bits + 7) >> 3;
 
     /* Set output picture properties */
     pic_out->i_type = h->fenc->i_type;
@@ -3980,6 +4505,12 @@ static int encoder_frame_end( x264_t *h, x264_t *thread_current,
 
     pic_out->hrd_timing = h->fenc->hrd_timing;
     pic_out->prop.f_crf_avg = h->fdec->f_crf_avg;
+    if( h->param.analyse.b_mb_stats )
+    {
+        pic_out->prop.mb_qp = h->mb.qp;
+        pic_out->prop.mb_ssd = h->mb.ssd;
+        pic_out->prop.mb_ssim = h->mb.ssim;
+    }
 
     /* Filler in AVC-Intra mode is written as zero bytes to the last slice
      * We don't know the size of the last slice until encapsulation so we add filler to the encapsulated NAL */
@@ -4034,8 +4565,8 @@ static int encoder_frame_end( x264_t *h, x264_t *thread_current,
         }
     }
 
-    /* End bitstream, set output  */
-    *pi_nal = h->out.i_nal;
+    /* End bitstream, set output. A stats-only pass has nothing valid to output. */
+    *pi_nal = h->param.rc.b_stats_only ? 0 : h->out.i_nal;
     *pp_nal = h->out.nal;
 
     h->out.i_nal = 0;
@@ -4126,6 +4657,14 @@ static int encoder_frame_end( x264_t *h, x264_t *thread_current,
         int msg_len = strlen(psz_message);
         snprintf( psz_message + msg_len, 80 - msg_len, " SSIM Y:%.5f", pic_out->prop.f_ssim );
     }
+
+    if( h->param.analyse.b_vif )
+    {
+        pic_out->prop.f_vif = h->stat.frame.f_vif[1] > 0 ? h->stat.frame.f_vif[0] / h->stat.frame.f_vif[1] : 1.0;
+        h->stat.f_vif_mean_y[h->sh.i_type] += pic_out->prop.f_vif * dur;
+        int msg_len = strlen(psz_message);
+        snprintf( psz_message + msg_len, 80 - msg_len, " VIF Y:%.5f", pic_out->prop.f_vif );
+    }
     psz_message[79] = '\0';
 
     x264_log( h, X264_LOG_DEBUG,
@@ -4215,6 +4754,9 @@ void    x264_encoder_close  ( x264_t *h )
         x264_threadpool_delete( h->threadpool );
     if( h->param.i_lookahead_threads > 1 )
         x264_threadpool_delete( h->lookaheadpool );
+    /* cabac-thread may have been turned off by a reconfig since. */
+    if( h->writepool )
+        x264_threadpool_delete( h->writepool );
     if( h->i_thread_frames > 1 )
     {
         for( int i = 0; i < h->i_thread_frames; i++ )
@@ -4493,6 +5035,8 @@ void    x264_encoder_close  ( x264_t *h )
             float ssim = SUM3( h->stat.f_ssim_mean_y ) / duration;
             x264_log( h, X264_LOG_INFO, "SSIM Mean Y:%.7f (%6.3fdb)\n", ssim, calc_ssim_db( ssim ) );
         }
+        if( h->param.analyse.b_vif )
+            x264_log( h, X264_LOG_INFO, "VIF Mean Y:%.7f\n", SUM3( h->stat.f_vif_mean_y ) / duration );
         if( h->param.analyse.b_psnr )
         {
             x264_log( h, X264_LOG_INFO,
@@ -4510,6 +5054,7 @@ void    x264_encoder_close  ( x264_t *h )
 
     /* rc */
     x264_ratecontrol_delete( h );
+    x264_speedcontrol_delete( h );
 
     /* param */
     x264_param_cleanup( &h->param );
@@ -4569,6 +5114,14 @@ void    x264_encoder_close  ( x264_t *h )
         x264_free( h->thread[i]->out.nal );
         x264_pthread_mutex_destroy( &h->thread[i]->mutex );
         x264_pthread_cond_destroy( &h->thread[i]->cv );
+        if( h->thread[i]->mb_writer )
+        {
+            x264_pthread_mutex_destroy( &h->thread[i]->mb_writer->mutex );
+            x264_pthread_cond_destroy( &h->thread[i]->mb_writer->cv );
+            x264_free( h->thread[i]->mb_writer->h );
+            x264_free( h->thread[i]->mb_writer->i_row_bits );
+            x264_free( h->thread[i]->mb_writer );
+        }
         x264_free( h->thread[i] );
     }
 #if HAVE_OPENCL
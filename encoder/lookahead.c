@@ -64,9 +64,44 @@ static void lookahead_update_last_nonb( x264_t *h, x264_frame_t *new_nonb )
     new_nonb->i_reference_count++;
 }
 
+/* Flag the macroblocks of each pending frame that are identical to the previous input frame,
+ * so that analysis can use the mb_info fast-skip for them. */
+static void lookahead_static_detect( x264_t *h )
+{
+    x264_sync_frame_list_t *next = &h->lookahead->next;
+    for( int i = 0; i < next->i_size; i++ )
+    {
+        x264_frame_t *cur = next->list[i];
+        x264_frame_t *prev = i ? next->list[i-1] : h->lookahead->last_nonb;
+        if( cur->mb_info || !prev || prev->i_frame != cur->i_frame - 1 )
+            continue;
+        cur->mb_info = x264_malloc( h->mb.i_mb_count );
+        if( !cur->mb_info )
+            continue;
+        cur->mb_info_free = x264_free;
+
+        for( int mb_y = 0; mb_y < h->mb.i_mb_height; mb_y++ )
+            for( int mb_x = 0; mb_x < h->mb.i_mb_width; mb_x++ )
+            {
+                int b_constant = 1;
+                for( int p = 0; p < cur->i_plane && b_constant; p++ )
+                {
+                    int height = p && !CHROMA444 ? 16 >> CHROMA_V_SHIFT : 16;
+                    intptr_t stride = cur->i_stride[p];
+                    int offs = mb_y*height*stride + 16*mb_x;
+                    b_constant = !h->pixf.sad[height == 16 ? PIXEL_16x16 : PIXEL_16x8]( cur->plane[p] + offs, stride,
+                                                                                        prev->plane[p] + offs, stride );
+                }
+                cur->mb_info[mb_y*h->mb.i_mb_stride + mb_x] = b_constant ? X264_MBINFO_CONSTANT : 0;
+            }
+    }
+}
+
 #if HAVE_THREAD
 static void lookahead_slicetype_decide( x264_t *h )
 {
+    if( h->param.analyse.b_static_detect )
+        lookahead_static_detect( h );
     x264_slicetype_decide( h );
 
     lookahead_update_last_nonb( h, h->lookahead->next.list[0] );
@@ -236,6 +271,8 @@ void x264_lookahead_get_frames( x264_t *h )
         if( h->frames.current[0] || !h->lookahead->next.i_size )
             return;
 
+        if( h->param.analyse.b_static_detect )
+            lookahead_static_detect( h );
         x264_slicetype_decide( h );
         lookahead_update_last_nonb( h, h->lookahead->next.list[0] );
         int shift_frames = h->lookahead->next.list[0]->i_bframes + 1;
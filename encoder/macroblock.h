@@ -65,12 +65,18 @@ void x264_mb_encode_chroma( x264_t *h, int b_inter, int i_qp );
 
 #define x264_cabac_mb_skip x264_template(cabac_mb_skip)
 void x264_cabac_mb_skip( x264_t *h, int b_skip );
+#define x264_macroblock_size_stats x264_template(macroblock_size_stats)
+void x264_macroblock_size_stats( x264_t *h );
+#define x264_macroblock_cabac_mvd x264_template(macroblock_cabac_mvd)
+void x264_macroblock_cabac_mvd( x264_t *h );
 #define x264_cabac_block_residual_c x264_template(cabac_block_residual_c)
 void x264_cabac_block_residual_c( x264_t *h, x264_cabac_t *cb, int ctx_block_cat, dctcoef *l );
 #define x264_cabac_block_residual_8x8_rd_c x264_template(cabac_block_residual_8x8_rd_c)
 void x264_cabac_block_residual_8x8_rd_c( x264_t *h, x264_cabac_t *cb, int ctx_block_cat, dctcoef *l );
 #define x264_cabac_block_residual_rd_c x264_template(cabac_block_residual_rd_c)
 void x264_cabac_block_residual_rd_c( x264_t *h, x264_cabac_t *cb, int ctx_block_cat, dctcoef *l );
+#define x264_cabac_rd_table_init x264_template(cabac_rd_table_init)
+void x264_cabac_rd_table_init( x264_t *h, int ctx_block_cat );
 
 #define x264_quant_luma_dc_trellis x264_template(quant_luma_dc_trellis)
 int x264_quant_luma_dc_trellis( x264_t *h, dctcoef *dct, int i_quant_cat, int i_qp,
@@ -823,12 +823,80 @@ void x264_me_refine_qpel_refdupe( x264_t *h, x264_me_t *m, int *p_halfpel_thresh
     COPY3_IF_LT( bcost, cost, bmx, mx, bmy, my ); \
 }
 
+/* Luma mbcmp cost of a partition at a subpel mv, excluding the mv cost.
+ * mbcmp is additive over 8x8 blocks, so partitions of 8x8 and larger are costed per 8x8 block
+ * and each block's cost is cached: the 16x16, 16x8, 8x16 and 8x8 searches (and the final qpel
+ * refinement) of an mb mostly revisit the same mvs on the same refs. */
+static int subpel_luma_cost( x264_t *h, x264_me_t *m, pixel *pix, int mx, int my, int bw, int bh )
+{
+    const int i_pixel = m->i_pixel;
+    intptr_t offset = m->p_fenc[0] - h->mb.pic.p_fenc[0];
+    intptr_t stride = 16;
+    pixel *src;
+
+    if( i_pixel > PIXEL_8x8 || (offset & ~(8+8*FENC_STRIDE)) )
+    {
+        src = h->mc.get_ref( pix, &stride, &m->p_fref[0], m->i_stride[0], mx, my, bw, bh, &m->weight[0] );
+        return h->pixf.mbcmp_unaligned[i_pixel]( m->p_fenc[0], FENC_STRIDE, src, stride );
+    }
+
+    int i8 = ((offset >> 3) & 1) + ((offset >> 6) & 2);
+    int slot = (mx&7) + ((my&7)<<3);
+    uint32_t mv = pack16to32( mx, my );
+    uint32_t gen = h->mb.i_subpel_cache_gen;
+    int costs[4];
+    int cost = 0;
+    int miss = 0;
+
+    for( int y = 0; y < bh; y += 8 )
+        for( int x = 0; x < bw; x += 8 )
+        {
+            int i = (x>>3) + (y>>2);
+            pixel *fref = m->p_fref[0] + x + y*m->i_stride[0];
+            x264_subpel_cache_t *c = &h->mb.subpel_cache[i8+i][slot];
+            if( c->i_gen == gen && c->mv == mv && c->fref == fref && c->weight == m->weight )
+            {
+                costs[i] = c->cost;
+                cost += c->cost;
+            }
+            else
+            {
+                costs[i] = -1;
+                miss = 1;
+            }
+        }
+
+    if( !miss )
+        return cost;
+
+    cost = 0;
+    src = h->mc.get_ref( pix, &stride, &m->p_fref[0], m->i_stride[0], mx, my, bw, bh, &m->weight[0] );
+    for( int y = 0; y < bh; y += 8 )
+        for( int x = 0; x < bw; x += 8 )
+        {
+            int i = (x>>3) + (y>>2);
+            if( costs[i] < 0 )
+            {
+                x264_subpel_cache_t *c = &h->mb.subpel_cache[i8+i][slot];
+                costs[i] = h->pixf.mbcmp_unaligned[PIXEL_8x8]( m->p_fenc[0] + x + y*FENC_STRIDE, FENC_STRIDE,
+                                                               src + x + y*stride, stride );
+                c->fref = m->p_fref[0] + x + y*m->i_stride[0];
+                c->weight = m->weight;
+                c->mv = mv;
+                c->i_gen = gen;
+                c->cost = costs[i];
+            }
+            cost += costs[i];
+        }
+    return cost;
+}
+
 #define COST_MV_SATD( mx, my, dir ) \
 if( b_refine_qpel || (dir^1) != odir ) \
 { \
-    intptr_t stride = 16; \
-    pixel *src = h->mc.get_ref( pix, &stride, &m->p_fref[0], m->i_stride[0], mx, my, bw, bh, &m->weight[0] ); \
-    int cost = h->pixf.mbcmp_unaligned[i_pixel]( m->p_fenc[0], FENC_STRIDE, src, stride ) \
+    intptr_t stride; \
+    pixel *src; \
+    int cost = subpel_luma_cost( h, m, pix, mx, my, bw, bh ) \
              + p_cost_mvx[ mx ] + p_cost_mvy[ my ]; \
     if( b_chroma_me && cost < bcost ) \
     { \
@@ -70,6 +70,16 @@ void x264_me_refine_qpel_rd( x264_t *h, x264_me_t *m, int i_lambda2, int i4, int
 void x264_me_refine_bidir_rd( x264_t *h, x264_me_t *m0, x264_me_t *m1, int i_weight, int i8, int i_lambda2 );
 #define x264_me_refine_bidir_satd x264_template(me_refine_bidir_satd)
 void x264_me_refine_bidir_satd( x264_t *h, x264_me_t *m0, x264_me_t *m1, int i_weight );
+/* called once per mb before any motion search, to drop the previous mb's cached subpel costs */
+static ALWAYS_INLINE void x264_me_subpel_cache_reset( x264_t *h )
+{
+    if( !++h->mb.i_subpel_cache_gen )
+    {
+        memset( h->mb.subpel_cache, 0, sizeof(h->mb.subpel_cache) );
+        h->mb.i_subpel_cache_gen = 1;
+    }
+}
+
 #define x264_rd_cost_part x264_template(rd_cost_part)
 uint64_t x264_rd_cost_part( x264_t *h, int i_lambda2, int i8, int i_pixel );
 
@@ -117,6 +117,16 @@ struct x264_ratecontrol_t
     double ip_offset;
     double pb_offset;
 
+    /* target-ssim: a CRF offset adjusted from the measured ssim, restarting at each scene */
+    double ssim_offset;         /* current offset */
+    double ssim_offset_frame;   /* offset the frame being encoded by this thread started with */
+    int    ssim_frames;         /* frames measured in the current scene */
+    int    ssim_scenes;
+    double ssim_scene_cplx;     /* log2 intra satd per mb of the current scene's first frame */
+    double ssim_prev_cplx;      /* same for the previous scene */
+    double ssim_prev_offset;    /* offset the previous scene converged to */
+    double ssim_slope;          /* learned offset change per doubling of scene complexity */
+
     /* 2pass stuff */
     FILE *p_stat_file_out;
     char *psz_stat_file_tmpname;
@@ -1345,6 +1355,9 @@ static x264_zone_t *get_zone( x264_t *h, int frame_num )
 void x264_ratecontrol_summary( x264_t *h )
 {
     x264_ratecontrol_t *rc = h->rc;
+    if( h->param.rc.f_target_ssim > 0 )
+        x264_log( h, X264_LOG_INFO, "target-ssim: final ratefactor %.2f over %d scene%s\n",
+                  h->param.rc.f_rf_constant + rc->ssim_offset, rc->ssim_scenes, rc->ssim_scenes == 1 ? "" : "s" );
     if( rc->b_abr && h->param.rc.i_rc_method == X264_RC_ABR && rc->cbr_decay > .9999 )
     {
         double base_cplx = h->mb.i_mb_count * (h->param.i_bframe ? 120 : 80);
@@ -1825,6 +1838,50 @@ void x264_ratecontrol_set_weights( x264_t *h, x264_frame_t *frm )
     }
 }
 
+/* Move the CRF offset toward the one that gives the target ssim. Within a scene the
+ * step shrinks with the number of frames measured, so the offset settles on the
+ * scene's average quality rather than chasing the I/P/B pattern. At a scene cut,
+ * found as an I-frame whose lookahead intra cost differs a lot from the previous
+ * scene's, the offset is first moved by how much complexity changes have needed
+ * so far, and the step is reset. */
+static void target_ssim_update( x264_t *h )
+{
+    x264_ratecontrol_t *rc = h->rc;
+    double target = h->param.rc.f_target_ssim;
+    double ssim = h->stat.frame.f_ssim / h->stat.frame.i_ssim_cnt;
+    /* The error is linear in ssim, so that it's the mean ssim that converges,
+     * scaled to dB at the target. */
+    double err_db = 10.0 / log( 10.0 ) * (target - ssim) / (1.0 - target);
+
+    if( h->sh.i_type == SLICE_TYPE_I && rc->last_satd > 0 )
+    {
+        double cplx = log2( (double)rc->last_satd / h->mb.i_mb_count );
+        if( !rc->ssim_scenes || fabs( cplx - rc->ssim_scene_cplx ) > 0.5 )
+        {
+            if( rc->ssim_scenes > 1 && fabs( rc->ssim_scene_cplx - rc->ssim_prev_cplx ) > 0.5 )
+            {
+                double slope = (rc->ssim_offset - rc->ssim_prev_offset) / (rc->ssim_scene_cplx - rc->ssim_prev_cplx);
+                rc->ssim_slope = rc->ssim_slope * 0.5 + x264_clip3f( slope, -8, 8 ) * 0.5;
+            }
+            if( rc->ssim_scenes )
+            {
+                rc->ssim_prev_cplx = rc->ssim_scene_cplx;
+                rc->ssim_prev_offset = rc->ssim_offset;
+                rc->ssim_offset += rc->ssim_slope * (cplx - rc->ssim_scene_cplx);
+            }
+            rc->ssim_scene_cplx = cplx;
+            rc->ssim_frames = 0;
+            rc->ssim_scenes++;
+        }
+    }
+
+    /* Roughly 2.5 CRF per dB of ssim. */
+    rc->ssim_frames++;
+    rc->ssim_offset -= 2.5 * err_db / X264_MIN( rc->ssim_frames, 10 );
+    rc->ssim_offset = x264_clip3f( rc->ssim_offset, -20, 20 );
+    rc->ssim_offset = x264_clip3f( h->param.rc.f_rf_constant + rc->ssim_offset, -QP_BD_OFFSET, 51 ) - h->param.rc.f_rf_constant;
+}
+
 /* After encoding one frame, save stats and update ratecontrol state */
 int x264_ratecontrol_end( x264_t *h, int bits, int *filler )
 {
@@ -1841,7 +1898,11 @@ int x264_ratecontrol_end( x264_t *h, int bits, int *filler )
 
     h->fdec->f_qp_avg_rc = rc->qpa_rc /= h->mb.i_mb_count;
     h->fdec->f_qp_avg_aq = (float)rc->qpa_aq / h->mb.i_mb_count;
-    h->fdec->f_crf_avg = h->param.rc.f_rf_constant + h->fdec->f_qp_avg_rc - rc->qp_novbv;
+    h->fdec->f_crf_offset = rc->ssim_offset_frame;
+    h->fdec->f_crf_avg = h->param.rc.f_rf_constant + rc->ssim_offset_frame + h->fdec->f_qp_avg_rc - rc->qp_novbv;
+
+    if( h->param.rc.f_target_ssim > 0 && h->stat.frame.i_ssim_cnt )
+        target_ssim_update( h );
 
     if( h->param.rc.b_stat_write )
     {
@@ -2429,6 +2490,8 @@ static float rate_estimate_qscale( x264_t *h )
         int dt1 = abs(h->fenc->i_poc - h->fref_nearest[1]->i_poc);
         float q0 = h->fref_nearest[0]->f_qp_avg_rc;
         float q1 = h->fref_nearest[1]->f_qp_avg_rc;
+        float o0 = h->fref_nearest[0]->f_crf_offset;
+        float o1 = h->fref_nearest[1]->f_crf_offset;
 
         if( h->fref_nearest[0]->i_type == X264_TYPE_BREF )
             q0 -= rcc->pb_offset/2;
@@ -2444,6 +2507,16 @@ static float rate_estimate_qscale( x264_t *h )
         else
             q = (q0*dt1 + q1*dt0) / (dt0 + dt1);
 
+        /* The CRF offset of --target-ssim comes along with the qp. */
+        if( i0 && i1 )
+            rcc->ssim_offset_frame = (o0 + o1) / 2;
+        else if( i0 )
+            rcc->ssim_offset_frame = o1;
+        else if( i1 )
+            rcc->ssim_offset_frame = o0;
+        else
+            rcc->ssim_offset_frame = (o0*dt1 + o1*dt0) / (dt0 + dt1);
+
         if( h->fenc->b_kept_as_ref )
             q += rcc->pb_offset/2;
         else
@@ -2574,7 +2647,9 @@ static float rate_estimate_qscale( x264_t *h )
 
             if( h->param.rc.i_rc_method == X264_RC_CRF )
             {
-                q = get_qscale( h, &rce, rcc->rate_factor_constant, h->fenc->i_frame );
+                /* A CRF offset of d multiplies qscale by 2^(d/6). */
+                rcc->ssim_offset_frame = rcc->ssim_offset;
+                q = get_qscale( h, &rce, rcc->rate_factor_constant * pow( 2, -rcc->ssim_offset / 6 ), h->fenc->i_frame );
             }
             else
             {
@@ -2796,6 +2871,13 @@ void x264_thread_sync_ratecontrol( x264_t *cur, x264_t *prev, x264_t *next )
         COPY(initial_cpb_removal_delay_offset);
         COPY(nrt_first_access_unit);
         COPY(previous_cpb_final_arrival_time);
+        COPY(ssim_offset);
+        COPY(ssim_frames);
+        COPY(ssim_scenes);
+        COPY(ssim_scene_cplx);
+        COPY(ssim_prev_cplx);
+        COPY(ssim_prev_offset);
+        COPY(ssim_slope);
 #undef COPY
     }
     //FIXME row_preds[] (not strictly necessary, but would improve prediction)
@@ -26,7 +26,7 @@
 
 /* duplicate all the writer functions, just calculating bit cost
  * instead of writing the bitstream.
- * TODO: use these for fast 1st pass too. */
+ * These are also used by stats-only first passes. */
 
 #define RDO_SKIP_BS 1
 
@@ -60,7 +60,9 @@ static uint16_t cabac_size_5ones[128];
 #undef  x264_cabac_encode_terminal
 #undef  x264_cabac_encode_ue_bypass
 #define x264_cabac_encode_decision(c,x,v) x264_cabac_size_decision(c,x,v)
-#define x264_cabac_encode_decision_noup(c,x,v) x264_cabac_size_decision_noup(c,x,v)
+/* The writer's noup contexts aren't read again within the mb, so updating them doesn't change
+ * RD costs, but stats-only passes carry the states over to the following mbs. */
+#define x264_cabac_encode_decision_noup(c,x,v) x264_cabac_size_decision(c,x,v)
 #define x264_cabac_encode_terminal(c)     ((c)->f8_bits_encoded += 7)
 #define x264_cabac_encode_bypass(c,v)     ((c)->f8_bits_encoded += 256)
 #define x264_cabac_encode_ue_bypass(c,e,v) ((c)->f8_bits_encoded += (bs_size_ue_big(v+(1<<e)-1)-e)<<8)
@@ -196,6 +198,48 @@ static int rd_cost_mb( x264_t *h, int i_lambda2 )
     return X264_MIN( i_ssd + i_bits, COST_MAX );
 }
 
+/* Stats-only first pass: code the current macroblock and its skip flag into the slice's
+ * contexts by size only, and count its bits in the frame stats as the writer would.
+ * A skip flag is typically well under a bit, so the fractions are carried over to the
+ * following macroblocks rather than rounded away. */
+void x264_macroblock_size_stats( x264_t *h )
+{
+    int chroma = !CHROMA444 && CHROMA_FORMAT;
+
+    if( h->sh.i_type != SLICE_TYPE_I )
+    {
+        int ctx = h->mb.cache.i_neighbour_skip + 11 + 13*(h->sh.i_type != SLICE_TYPE_P);
+        x264_cabac_size_decision( &h->cabac, ctx, IS_SKIP( h->mb.i_type ) );
+    }
+    if( !IS_SKIP( h->mb.i_type ) )
+    {
+        /* Split the macroblock into header and residual on a copy of the contexts,
+         * since the header can't be coded on its own. */
+        x264_cabac_t cabac_tmp;
+        COPY_CABAC;
+        if( h->sh.i_type == SLICE_TYPE_P )
+            cabac_mb_header_p( h, &cabac_tmp, h->mb.i_type, chroma );
+        else if( h->sh.i_type == SLICE_TYPE_B )
+            cabac_mb_header_b( h, &cabac_tmp, h->mb.i_type, chroma );
+        else
+            cabac_mb_header_i( h, &cabac_tmp, h->mb.i_type, SLICE_TYPE_I, chroma );
+        int f8_start = h->cabac.f8_bits_encoded;
+        int f8_mv = cabac_tmp.f8_bits_encoded - f8_start;
+
+        macroblock_size_cabac( h, &h->cabac );
+        int f8_tex = h->cabac.f8_bits_encoded - f8_start - f8_mv;
+
+        h->stat.frame.i_sized_mv_f8 += f8_mv;
+        h->stat.frame.i_mv_bits += h->stat.frame.i_sized_mv_f8 >> 8;
+        h->stat.frame.i_sized_mv_f8 &= 255;
+        h->stat.frame.i_sized_tex_f8 += f8_tex;
+        h->stat.frame.i_tex_bits += h->stat.frame.i_sized_tex_f8 >> 8;
+        h->stat.frame.i_sized_tex_f8 &= 255;
+    }
+    h->stat.frame.i_sized_bits += h->cabac.f8_bits_encoded >> 8;
+    h->cabac.f8_bits_encoded &= 255;
+}
+
 /* partition RD functions use 8 bits more precision to avoid large rounding errors at low QPs */
 
 static uint64_t rd_cost_subpart( x264_t *h, int i_lambda2, int i4, int i_pixel )
@@ -371,6 +415,20 @@ static uint64_t rd_cost_chroma( x264_t *h, int i_lambda2, int i_mode, int b_dct
 
     return (i_ssd<<8) + i_bits;
 }
+
+/* Fill in the mvds of the current inter mb, which the cabac contexts of later mbs
+ * depend on, without writing anything.  Used when the bitstream is written by a
+ * separate thread that may not have reached this mb yet. */
+void x264_macroblock_cabac_mvd( x264_t *h )
+{
+    x264_cabac_t cabac_tmp;
+    COPY_CABAC;
+    if( h->sh.i_type == SLICE_TYPE_P )
+        cabac_mb_header_p( h, &cabac_tmp, h->mb.i_type, 0 );
+    else
+        cabac_mb_header_b( h, &cabac_tmp, h->mb.i_type, 0 );
+}
+
 /****************************************************************************
  * Trellis RD quantization
  ****************************************************************************/
@@ -541,6 +541,7 @@ static void slicetype_mb_cost( x264_t *h, x264_mb_analysis_t *a,
     /* A small, arbitrary bias to avoid VBV problems caused by zero-residual lookahead blocks. */
     int lowres_penalty = 4;
 
+    x264_me_subpel_cache_reset( h );
     h->mb.pic.p_fenc[0] = h->mb.pic.fenc_buf;
     h->mc.copy[PIXEL_8x8]( h->mb.pic.p_fenc[0], FENC_STRIDE, &fenc->lowres[0][i_pel_offset], i_stride, 8 );
 
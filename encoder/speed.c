@@ -0,0 +1,208 @@
+/*****************************************************************************
+ * speed.c: speed control
+ *****************************************************************************
+ * Copyright (C) 2003-2025 x264 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at licensing@x264.com.
+ *****************************************************************************/
+
+#include "common/common.h"
+#include "ratecontrol.h"
+#include "speed.h"
+
+/* Speed control picks, before each frame, one of a ladder of analysis settings
+ * such that the predicted encoding time keeps a buffer of slack from draining.
+ * The time per frame is measured as the wall clock between consecutive frames,
+ * so it includes everything the caller does in between (input, output), which
+ * is what has to keep up with realtime. */
+
+typedef struct
+{
+    float cost;         /* rough time per frame, relative to the fastest level */
+    int   subme;
+    int   me;
+    int   refs;
+    int   partitions;   /* mask applied to both analyse.intra and analyse.inter */
+    int   trellis;
+    int   mixed_refs;
+} speed_level_t;
+
+#define PARTS_I   (X264_ANALYSE_I4x4|X264_ANALYSE_I8x8)
+#define PARTS_PB  (PARTS_I|X264_ANALYSE_PSUB16x16|X264_ANALYSE_BSUB16x16)
+
+/* Each knob is further limited by the user's own settings, so the last level,
+ * which limits nothing, is exactly what was asked for. */
+static const speed_level_t speed_levels[] =
+{
+    { 1.00,  1, X264_ME_DIA,  1, 0,                               0, 0 },
+    { 1.25,  2, X264_ME_DIA,  1, PARTS_I,                         0, 0 },
+    { 1.60,  4, X264_ME_HEX,  2, PARTS_I|X264_ANALYSE_PSUB16x16,  0, 0 },
+    { 2.10,  6, X264_ME_HEX,  2, PARTS_PB,                        1, 0 },
+    { 2.70,  7, X264_ME_HEX,  3, PARTS_PB,                        1, 1 },
+    { 3.60,  8, X264_ME_HEX,  5, PARTS_PB,                        1, 1 },
+    { 5.00,  9, X264_ME_UMH,  8, PARTS_PB|X264_ANALYSE_PSUB8x8,   2, 1 },
+    { 7.00, 11, X264_ME_TESA, X264_REF_MAX, ~0,                   2, 1 },
+};
+#define SPEED_LEVELS ARRAY_ELEMS(speed_levels)
+
+#undef PARTS_I
+#undef PARTS_PB
+
+struct x264_speedcontrol_t
+{
+    speed_level_t level[SPEED_LEVELS]; /* the ladder limited by the user's settings, duplicates removed */
+    int     i_levels;
+    int     i_level;
+    int     i_intra;        /* the user's partition masks */
+    int     i_inter;
+
+    float   f_frame_time;   /* target time per frame (us) */
+    float   f_buffer_size;  /* (us) */
+    float   f_buffer_fill;  /* (us) */
+    float   f_unit_time;    /* estimated time of a frame of cost 1.0 (us) */
+    int64_t i_prev_time;
+
+    /* stats */
+    int64_t i_start_time;
+    int     i_frames;
+    int64_t i_level_sum;
+};
+
+static void level_limit( speed_level_t *dst, const speed_level_t *lim, const x264_param_t *p )
+{
+    dst->cost       = lim->cost;
+    dst->subme      = X264_MIN( p->analyse.i_subpel_refine, lim->subme );
+    dst->me         = X264_MIN( p->analyse.i_me_method, lim->me );
+    dst->refs       = X264_MIN( p->i_frame_reference, lim->refs );
+    dst->partitions = lim->partitions;
+    dst->trellis    = X264_MIN( p->analyse.i_trellis, lim->trellis );
+    dst->mixed_refs = p->analyse.b_mixed_references && lim->mixed_refs;
+}
+
+int x264_speedcontrol_new( x264_t *h )
+{
+    /* Entering a zone that sets options applies them, and leaving it the user's
+     * own settings, whatever level speed control has picked meanwhile. */
+    for( int i = 0; i < h->param.rc.i_zones; i++ )
+        if( h->param.rc.zones[i].param )
+        {
+            x264_log( h, X264_LOG_ERROR, "speed: zones that set options can't be used with speed control\n" );
+            return -1;
+        }
+
+    x264_speedcontrol_t *sc;
+    CHECKED_MALLOCZERO( sc, sizeof(x264_speedcontrol_t) );
+    sc->i_intra = h->param.analyse.intra;
+    sc->i_inter = h->param.analyse.inter;
+
+    for( int i = 0; i < SPEED_LEVELS; i++ )
+    {
+        speed_level_t l;
+        level_limit( &l, &speed_levels[i], &h->param );
+        l.partitions &= sc->i_intra | sc->i_inter;
+        speed_level_t *prev = sc->i_levels ? &sc->level[sc->i_levels-1] : NULL;
+        if( prev && prev->subme == l.subme && prev->me == l.me && prev->refs == l.refs &&
+            prev->partitions == l.partitions && prev->trellis == l.trellis && prev->mixed_refs == l.mixed_refs )
+            continue;
+        sc->level[sc->i_levels++] = l;
+    }
+    sc->i_level = sc->i_levels - 1;
+
+    sc->f_frame_time = 1e6f * h->param.i_fps_den / (h->param.i_fps_num * h->param.sc.f_speed);
+    sc->f_buffer_size = sc->f_frame_time * h->param.sc.i_buffer_size;
+    sc->f_buffer_fill = sc->f_buffer_size;
+
+    if( h->param.analyse.i_me_method >= X264_ME_ESA )
+        x264_log( h, X264_LOG_WARNING, "speed: %s can't be resumed once speed control has lowered it\n",
+                  x264_motion_est_names[h->param.analyse.i_me_method] );
+
+    for( int i = 0; i < h->param.i_threads; i++ )
+        h->thread[i]->sc = sc;
+    return 0;
+fail:
+    return -1;
+}
+
+void x264_speedcontrol_delete( x264_t *h )
+{
+    x264_speedcontrol_t *sc = h->sc;
+    if( !sc )
+        return;
+    if( sc->i_frames > 1 )
+    {
+        float fps = (sc->i_frames - 1) * 1e6f / (sc->i_prev_time - sc->i_start_time);
+        x264_log( h, X264_LOG_INFO, "speed: %.2f fps (target %.2f), average level %.2f of %d\n",
+                  fps, 1e6f / sc->f_frame_time, (double)sc->i_level_sum / sc->i_frames, sc->i_levels - 1 );
+    }
+    x264_free( sc );
+}
+
+static void speedcontrol_apply( x264_t *h, x264_speedcontrol_t *sc, const speed_level_t *l )
+{
+    x264_param_t p = h->param;
+    p.analyse.i_subpel_refine = l->subme;
+    p.analyse.i_me_method = l->me;
+    p.i_frame_reference = l->refs;
+    p.analyse.intra = sc->i_intra & l->partitions;
+    p.analyse.inter = sc->i_inter & l->partitions;
+    p.analyse.i_trellis = l->trellis;
+    p.analyse.b_mixed_references = l->mixed_refs;
+    x264_encoder_reconfig_apply( h, &p );
+}
+
+/* Called once per encoded frame, before its analysis settings are used. */
+void x264_speedcontrol_frame( x264_t *h )
+{
+    x264_speedcontrol_t *sc = h->sc;
+    int64_t now = x264_mdate();
+
+    x264_emms();
+    if( sc->i_prev_time )
+    {
+        float spent = now - sc->i_prev_time;
+        float unit = spent / sc->level[sc->i_level].cost;
+        sc->f_unit_time = sc->f_unit_time ? sc->f_unit_time * 0.9f + unit * 0.1f : unit;
+        sc->f_buffer_fill = x264_clip3f( sc->f_buffer_fill + sc->f_frame_time - spent, 0, sc->f_buffer_size );
+    }
+    else
+        sc->i_start_time = now;
+    sc->i_prev_time = now;
+
+    /* Spend up to half a frame more than realtime while the buffer is full, and
+     * aim for half the realtime budget while it is empty, so that it refills. */
+    if( sc->f_unit_time > 0 )
+    {
+        float allowed = sc->f_frame_time * (0.5f + sc->f_buffer_fill / sc->f_buffer_size);
+        int level = 0;
+        while( level + 1 < sc->i_levels && sc->level[level+1].cost * sc->f_unit_time <= allowed )
+            level++;
+        /* Drop as far as needed at once, but climb one step at a time so that a
+         * single cheap frame doesn't cause oscillation. */
+        level = X264_MIN( level, sc->i_level + 1 );
+        if( level != sc->i_level )
+        {
+            x264_log( h, X264_LOG_DEBUG, "speed: level %d -> %d (buffer %.0f%%)\n", sc->i_level, level,
+                      100.f * sc->f_buffer_fill / sc->f_buffer_size );
+            sc->i_level = level;
+            speedcontrol_apply( h, sc, &sc->level[level] );
+        }
+    }
+
+    sc->i_frames++;
+    sc->i_level_sum += sc->i_level;
+}
@@ -46,6 +46,8 @@ typedef struct
     int dst_csp;
     cli_pic_t buffer;
     int16_t *error_buf;
+    int b_ordered;
+    uint16_t threshold[16][16];
 } depth_hnd_t;
 
 static int depth_filter_csp_is_supported( int csp )
@@ -105,7 +107,43 @@ DITHER_PLANE( 2 )
 DITHER_PLANE( 3 )
 DITHER_PLANE( 4 )
 
-static void dither_image( cli_image_t *out, cli_image_t *img, int16_t *error_buf )
+/* Ordered dithering adds a 16x16 Bayer threshold matrix before truncating.
+ * Each output sample depends on its input sample alone, so rows can be done
+ * in any order and in parallel. Upconverted sources come back out lossless,
+ * as the threshold is always less than one output step. */
+#define ORDERED_PLANE( pitch ) \
+static void ordered_plane_##pitch( pixel *dst, int dst_stride, uint16_t *src, int src_stride, \
+                                   int width, int height, uint16_t threshold[16][16] ) \
+{ \
+    const int rshift = 16-BIT_DEPTH; \
+    const int pixel_max = (1 << BIT_DEPTH)-1; \
+    for( int y = 0; y < height; y++, src += src_stride, dst += dst_stride ) \
+    { \
+        uint16_t *t = threshold[y&15]; \
+        for( int x = 0; x < width; x++ ) \
+            dst[x*pitch] = X264_MIN( (src[x*pitch] + t[x&15]) >> rshift, pixel_max ); \
+    } \
+}
+
+ORDERED_PLANE( 1 )
+ORDERED_PLANE( 2 )
+ORDERED_PLANE( 3 )
+ORDERED_PLANE( 4 )
+
+static void init_threshold( uint16_t threshold[16][16] )
+{
+    /* the Bayer index interleaves the bits of x^y and y, msb first */
+    for( int y = 0; y < 16; y++ )
+        for( int x = 0; x < 16; x++ )
+        {
+            int bayer = 0;
+            for( int i = 0; i < 4; i++ )
+                bayer |= (((x^y) >> i & 1) << (7-2*i)) | ((y >> i & 1) << (6-2*i));
+            threshold[y][x] = (bayer << (16-BIT_DEPTH)) >> 8;
+        }
+}
+
+static void dither_image( cli_image_t *out, cli_image_t *img, depth_hnd_t *h )
 {
     int csp_mask = img->csp & X264_CSP_MASK;
     for( int i = 0; i < img->planes; i++ )
@@ -115,8 +153,12 @@ static void dither_image( cli_image_t *out, cli_image_t *img, int16_t *error_buf
         int width = x264_cli_csps[csp_mask].width[i] * img->width / num_interleaved;
 
 #define CALL_DITHER_PLANE( pitch, off ) \
-        dither_plane_##pitch( ((pixel*)out->plane[i])+off, out->stride[i]/SIZEOF_PIXEL, \
-                ((uint16_t*)img->plane[i])+off, img->stride[i]/2, width, height, error_buf )
+        if( h->b_ordered ) \
+            ordered_plane_##pitch( ((pixel*)out->plane[i])+off, out->stride[i]/SIZEOF_PIXEL, \
+                    ((uint16_t*)img->plane[i])+off, img->stride[i]/2, width, height, h->threshold ); \
+        else \
+            dither_plane_##pitch( ((pixel*)out->plane[i])+off, out->stride[i]/SIZEOF_PIXEL, \
+                    ((uint16_t*)img->plane[i])+off, img->stride[i]/2, width, height, h->error_buf )
 
         if( num_interleaved == 4 )
         {
@@ -174,7 +216,7 @@ static int get_frame( hnd_t handle, cli_pic_t *output, int frame )
 
     if( h->bit_depth < 16 && output->img.csp & X264_CSP_HIGH_DEPTH )
     {
-        dither_image( &h->buffer.img, &output->img, h->error_buf );
+        dither_image( &h->buffer.img, &output->img, h );
         output->img = h->buffer.img;
     }
     else if( h->bit_depth > 8 && !(output->img.csp & X264_CSP_HIGH_DEPTH) )
@@ -206,10 +248,11 @@ static int init( hnd_t *handle, cli_vid_filter_t *filter, video_info_t *info,
     int change_fmt = (info->csp ^ param->i_csp) & X264_CSP_HIGH_DEPTH;
     int csp = ~(~info->csp ^ change_fmt);
     int bit_depth = 8*x264_cli_csp_depth_factor( csp );
+    int b_ordered = 0;
 
     if( opt_string )
     {
-        static const char * const optlist[] = { "bit_depth", NULL };
+        static const char * const optlist[] = { "bit_depth", "dither", NULL };
         char **opts = x264_split_options( opt_string, optlist );
 
         if( opts )
@@ -220,6 +263,12 @@ static int init( hnd_t *handle, cli_vid_filter_t *filter, video_info_t *info,
             ret = bit_depth < 8 || bit_depth > 16;
             csp = bit_depth > 8 ? csp | X264_CSP_HIGH_DEPTH : csp & ~X264_CSP_HIGH_DEPTH;
             change_fmt = (info->csp ^ csp) & X264_CSP_HIGH_DEPTH;
+            char *str_dither = x264_get_option( "dither", opts );
+            if( str_dither )
+            {
+                b_ordered = !strcasecmp( str_dither, "ordered" );
+                ret |= !b_ordered && strcasecmp( str_dither, "diffusion" );
+            }
             free( opts );
         }
         else
@@ -227,7 +276,7 @@ static int init( hnd_t *handle, cli_vid_filter_t *filter, video_info_t *info,
     }
 
     FAIL_IF_ERROR( bit_depth != BIT_DEPTH, "this filter supports only bit depth %d\n", BIT_DEPTH );
-    FAIL_IF_ERROR( ret, "unsupported bit depth conversion.\n" );
+    FAIL_IF_ERROR( ret, "unsupported bit depth conversion or dither mode.\n" );
 
     /* only add the filter to the chain if it's needed */
     if( change_fmt || bit_depth != 8 * x264_cli_csp_depth_factor( csp ) )
@@ -241,6 +290,9 @@ static int init( hnd_t *handle, cli_vid_filter_t *filter, video_info_t *info,
         h->error_buf = (int16_t*)(h + 1);
         h->dst_csp = csp;
         h->bit_depth = bit_depth;
+        h->b_ordered = b_ordered;
+        if( b_ordered )
+            init_threshold( h->threshold );
         h->prev_hnd = *handle;
         h->prev_filter = *filter;
 
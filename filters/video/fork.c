@@ -0,0 +1,102 @@
+/*****************************************************************************
+ * fork.c: fork video filter
+ *****************************************************************************
+ * Copyright (C) 2010-2025 x264 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at licensing@x264.com.
+ *****************************************************************************/
+
+#include "video.h"
+
+#define NAME "fork"
+
+/* Shares the previous filter between several chains (branches) that all ask
+ * for the same frames in lockstep: the current frame is fetched once and held
+ * until a branch asks for another one. Each branch frees the fork once, and
+ * the previous filter goes with the last of them. */
+typedef struct
+{
+    hnd_t prev_hnd;
+    cli_vid_filter_t prev_filter;
+
+    int refs;
+    int cur_frame;      /* frame held, -1 if none */
+    cli_pic_t pic;
+} fork_hnd_t;
+
+cli_vid_filter_t fork_filter;
+
+static int init( hnd_t *handle, cli_vid_filter_t *filter, video_info_t *info, x264_param_t *param, char *opt_string )
+{
+    intptr_t branches = (intptr_t)opt_string;
+    /* upon a request for a single branch, do nothing */
+    if( branches <= 1 )
+        return 0;
+    fork_hnd_t *h = calloc( 1, sizeof(fork_hnd_t) );
+    if( !h )
+        return -1;
+
+    h->refs = branches;
+    h->cur_frame = -1;
+    h->prev_filter = *filter;
+    h->prev_hnd = *handle;
+    *handle = h;
+    *filter = fork_filter;
+
+    return 0;
+}
+
+static int release_held( fork_hnd_t *h )
+{
+    int ret = 0;
+    if( h->cur_frame >= 0 )
+        ret = h->prev_filter.release_frame( h->prev_hnd, &h->pic, h->cur_frame );
+    h->cur_frame = -1;
+    return ret;
+}
+
+static int get_frame( hnd_t handle, cli_pic_t *output, int frame )
+{
+    fork_hnd_t *h = handle;
+    if( frame != h->cur_frame )
+    {
+        if( release_held( h ) || h->prev_filter.get_frame( h->prev_hnd, &h->pic, frame ) )
+            return -1;
+        h->cur_frame = frame;
+    }
+    *output = h->pic;
+    return 0;
+}
+
+static int release_frame( hnd_t handle, cli_pic_t *pic, int frame )
+{
+    /* held until a branch moves on to another frame */
+    return 0;
+}
+
+static void free_filter( hnd_t handle )
+{
+    fork_hnd_t *h = handle;
+    if( --h->refs )
+        return;
+    release_held( h );
+    h->prev_filter.free( h->prev_hnd );
+    free( h );
+}
+
+cli_vid_filter_t fork_filter = { NAME, NULL, init, get_frame, release_frame, free_filter, NULL };
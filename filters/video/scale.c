@@ -0,0 +1,296 @@
+/*****************************************************************************
+ * scale.c: native resize video filter
+ *****************************************************************************
+ * Copyright (C) 2010-2025 x264 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at licensing@x264.com.
+ *****************************************************************************/
+
+#include "video.h"
+#include "scale.h"
+#include "common/threadpool.h"
+
+#define NAME "scale"
+#define FAIL_IF_ERROR( cond, ... ) FAIL_IF_ERR( cond, NAME, __VA_ARGS__ )
+
+#define MAX_SLICES 16
+
+cli_vid_filter_t scale_filter;
+
+typedef struct scale_hnd_t scale_hnd_t;
+
+typedef struct
+{
+    scale_hnd_t *h;
+    cli_image_t *in;
+    int slice;
+} scale_job_t;
+
+struct scale_hnd_t
+{
+    hnd_t prev_hnd;
+    cli_vid_filter_t prev_filter;
+
+    int high_depth;
+    int planes;
+    scale_plane_t plane[4];
+    cli_pic_t buffer;
+
+    int slices;
+    x264_threadpool_t *pool;
+    scale_job_t job[MAX_SLICES];
+};
+
+static void help( int longhelp )
+{
+    printf( "      "NAME":width,height[,sar][,method][,threads]\n" );
+    if( !longhelp )
+        return;
+    printf( "            resizes frames without swscale, keeping the colorspace:\n"
+            "            - resolution only: resizes and adapts sar to avoid stretching\n"
+            "            - resolution and sar: resizes to given resolution and sets the sar\n"
+            "            - method: use resizer method [\"bicubic\"]\n"
+            "               - " );
+    for( int i = 0; x264_scale_methods[i].name; i++ )
+        printf( "%s%s", x264_scale_methods[i].name, x264_scale_methods[i+1].name ? ", " : "\n" );
+    printf( "            - threads: number of threads, each resizing a slice of rows [auto]\n" );
+}
+
+static void *scale_h_slice( scale_job_t *job )
+{
+    scale_hnd_t *h = job->h;
+    for( int i = 0; i < h->planes; i++ )
+    {
+        scale_plane_t *p = &h->plane[i];
+        int y0 = p->src_height *  job->slice    / h->slices;
+        int y1 = p->src_height * (job->slice+1) / h->slices;
+        int32_t *dst = p->tmp + y0 * p->dst_width * p->comps;
+        uint8_t *src = job->in->plane[i] + y0 * job->in->stride[i];
+        if( h->high_depth )
+            x264_scale_h_16( dst, (uint16_t*)src, job->in->stride[i] / 2, y1 - y0, p, HSHIFT(1) );
+        else
+            x264_scale_h_8( dst, src, job->in->stride[i], y1 - y0, p, HSHIFT(0) );
+    }
+    return NULL;
+}
+
+static void *scale_v_slice( scale_job_t *job )
+{
+    scale_hnd_t *h = job->h;
+    cli_image_t *out = &h->buffer.img;
+    for( int i = 0; i < h->planes; i++ )
+    {
+        scale_plane_t *p = &h->plane[i];
+        int y0 = p->dst_height *  job->slice    / h->slices;
+        int y1 = p->dst_height * (job->slice+1) / h->slices;
+        uint8_t *dst = out->plane[i] + y0 * out->stride[i];
+        if( h->high_depth )
+            x264_scale_v_16( (uint16_t*)dst, out->stride[i] / 2, y0, y1, p, 2*COEF_BITS - HSHIFT(1) );
+        else
+            x264_scale_v_8( dst, out->stride[i], y0, y1, p, 2*COEF_BITS - HSHIFT(0) );
+    }
+    return NULL;
+}
+
+/* Run a pass on all slices and wait for them, as the vertical pass of a slice
+ * needs rows from the horizontal pass of its neighbours. */
+static void run_slices( scale_hnd_t *h, void *(*func)( scale_job_t * ) )
+{
+#if HAVE_THREAD
+    if( h->pool )
+    {
+        for( int i = 0; i < h->slices; i++ )
+            x264_threadpool_run( h->pool, (void*)func, &h->job[i] );
+        for( int i = 0; i < h->slices; i++ )
+            x264_threadpool_wait( h->pool, &h->job[i] );
+        return;
+    }
+#endif
+    for( int i = 0; i < h->slices; i++ )
+        func( &h->job[i] );
+}
+
+static int csp_is_supported( int csp )
+{
+    int csp_mask = csp & X264_CSP_MASK;
+    return !x264_cli_csp_is_invalid( csp ) && csp_mask != X264_CSP_YUYV && csp_mask != X264_CSP_UYVY;
+}
+
+static int handle_opts( scale_hnd_t *h, const char * const *optlist, char **opts, video_info_t *info, int *width, int *height )
+{
+    char *str_width  = x264_get_option( optlist[0], opts );
+    char *str_height = x264_get_option( optlist[1], opts );
+    char *str_sar    = x264_get_option( optlist[2], opts );
+    *width  = x264_otoi( str_width, -1 );
+    *height = x264_otoi( str_height, -1 );
+    FAIL_IF_ERROR( *width <= 0 || *height <= 0, "invalid resolution %sx%s\n",
+                   x264_otos( str_width, "<unset>" ), x264_otos( str_height, "<unset>" ) );
+
+    uint32_t in_sar_w = info->sar_width;
+    uint32_t in_sar_h = info->sar_height;
+    uint32_t out_sar_w, out_sar_h;
+    if( !in_sar_w || !in_sar_h )
+        in_sar_w = in_sar_h = 1;
+    if( str_sar )
+        FAIL_IF_ERROR( 2 != sscanf( str_sar, "%u:%u", &out_sar_w, &out_sar_h ) &&
+                       2 != sscanf( str_sar, "%u/%u", &out_sar_w, &out_sar_h ),
+                       "invalid sar `%s'\n", str_sar );
+    else
+    {
+        /* new_sar = (new_h * old_w * old_sar_w) / (old_h * new_w * old_sar_h) */
+        uint64_t num = (uint64_t)info->width  * *height;
+        uint64_t den = (uint64_t)info->height * *width;
+        x264_reduce_fraction64( &num, &den );
+        out_sar_w = num * in_sar_w;
+        out_sar_h = den * in_sar_h;
+        x264_reduce_fraction( &out_sar_w, &out_sar_h );
+    }
+    info->sar_width  = out_sar_w;
+    info->sar_height = out_sar_h;
+
+    char *str_threads = x264_get_option( optlist[4], opts );
+    h->slices = x264_otoi( str_threads, 0 );
+    FAIL_IF_ERROR( h->slices < 0, "invalid thread count `%s'\n", str_threads );
+    return 0;
+}
+
+static int init( hnd_t *handle, cli_vid_filter_t *filter, video_info_t *info, x264_param_t *param, char *opt_string )
+{
+    FAIL_IF_ERROR( !csp_is_supported( info->csp ), "unsupported colorspace\n" );
+    scale_hnd_t *h = calloc( 1, sizeof(scale_hnd_t) );
+    if( !h )
+        return -1;
+
+    static const char * const optlist[] = { "width", "height", "sar", "method", "threads", NULL };
+    char **opts = x264_split_options( opt_string, optlist );
+    if( !opts )
+        return -1;
+
+    int width, height;
+    int err = handle_opts( h, optlist, opts, info, &width, &height );
+    const char *str_method = x264_otos( x264_get_option( optlist[3], opts ), "bicubic" );
+    const scale_method_t *method = x264_scale_methods;
+    while( method->name && strcasecmp( method->name, str_method ) )
+        method++;
+    FAIL_IF_ERROR( !err && !method->name, "invalid method `%s'\n", str_method );
+    free( opts );
+    if( err )
+        return -1;
+
+    const x264_cli_csp_t *csp = x264_cli_get_csp( info->csp );
+    int csp_mask = info->csp & X264_CSP_MASK;
+    FAIL_IF_ERROR( width > MAX_RESOLUTION || height > MAX_RESOLUTION,
+                   "invalid width x height (%dx%d)\n", width, height );
+    FAIL_IF_ERROR( width % csp->mod_width || height % csp->mod_height,
+                   "resolution %dx%d is not compliant with colorspace %s\n", width, height, csp->name );
+    FAIL_IF_ERROR( height != info->height && info->interlaced,
+                   "interlaced vertical resizing is not supported\n" );
+
+    h->high_depth = !!(info->csp & X264_CSP_HIGH_DEPTH);
+    h->planes = csp->planes;
+    for( int i = 0; i < h->planes; i++ )
+    {
+        scale_plane_t *p = &h->plane[i];
+        /* packed rgb carries its components in the plane width, and the
+         * chroma plane of nv12/nv21/nv16 interleaves two */
+        p->comps = csp_mask >= X264_CSP_BGR ? (int)csp->width[0] : (i && h->planes == 2) ? 2 : 1;
+        float sub_w = csp->width[i] / (csp_mask >= X264_CSP_BGR ? csp->width[0] : p->comps);
+        p->src_width  = info->width  * sub_w;
+        p->src_height = info->height * csp->height[i];
+        p->dst_width  = width  * sub_w;
+        p->dst_height = height * csp->height[i];
+        if( x264_scale_init_kernel( &p->h, method, p->src_width, p->dst_width, sub_w < 1 ? 0.25 : 0.5 ) ||
+            x264_scale_init_kernel( &p->v, method, p->src_height, p->dst_height, 0.5 ) )
+            return -1;
+        p->tmp = malloc( (size_t)p->src_height * p->dst_width * p->comps * sizeof(int32_t) );
+        if( !p->tmp )
+            return -1;
+    }
+    if( x264_cli_pic_alloc_aligned( &h->buffer, info->csp, width, height ) )
+        return -1;
+
+    if( !h->slices )
+        h->slices = X264_MIN( x264_cpu_num_processors(), 8 );
+    h->slices = x264_clip3( h->slices, 1, X264_MIN( MAX_SLICES, height / csp->mod_height ) );
+    for( int i = 0; i < h->slices; i++ )
+    {
+        h->job[i].h = h;
+        h->job[i].slice = i;
+    }
+#if HAVE_THREAD
+    if( h->slices > 1 && x264_threadpool_init( &h->pool, h->slices ) )
+        return -1;
+#else
+    h->slices = 1;
+#endif
+
+    x264_cli_log( NAME, X264_LOG_INFO, "resizing to %dx%d with %s, %d thread%s\n",
+                  width, height, method->name, h->slices, h->slices > 1 ? "s" : "" );
+
+    info->width  = width;
+    info->height = height;
+
+    h->prev_filter = *filter;
+    h->prev_hnd = *handle;
+    *handle = h;
+    *filter = scale_filter;
+
+    return 0;
+}
+
+static int get_frame( hnd_t handle, cli_pic_t *output, int frame )
+{
+    scale_hnd_t *h = handle;
+    if( h->prev_filter.get_frame( h->prev_hnd, output, frame ) )
+        return -1;
+    FAIL_IF_ERROR( output->img.csp != h->buffer.img.csp, "stream properties changed at pts %"PRId64"\n", output->pts );
+    for( int i = 0; i < h->slices; i++ )
+        h->job[i].in = &output->img;
+    run_slices( h, scale_h_slice );
+    run_slices( h, scale_v_slice );
+    output->img = h->buffer.img;
+    return 0;
+}
+
+static int release_frame( hnd_t handle, cli_pic_t *pic, int frame )
+{
+    scale_hnd_t *h = handle;
+    return h->prev_filter.release_frame( h->prev_hnd, pic, frame );
+}
+
+static void free_filter( hnd_t handle )
+{
+    scale_hnd_t *h = handle;
+    h->prev_filter.free( h->prev_hnd );
+#if HAVE_THREAD
+    if( h->pool )
+        x264_threadpool_delete( h->pool );
+#endif
+    for( int i = 0; i < h->planes; i++ )
+    {
+        free( h->plane[i].h.pos );
+        free( h->plane[i].h.coef );
+        free( h->plane[i].v.pos );
+        free( h->plane[i].v.coef );
+        free( h->plane[i].tmp );
+    }
+    x264_cli_pic_clean( &h->buffer );
+    free( h );
+}
+
+cli_vid_filter_t scale_filter = { NAME, help, init, get_frame, release_frame, free_filter, NULL };
@@ -0,0 +1,72 @@
+/*****************************************************************************
+ * scale.h: native resize video filter kernels
+ *****************************************************************************
+ * Copyright (C) 2010-2025 x264 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at licensing@x264.com.
+ *****************************************************************************/
+
+#ifndef X264_FILTER_VIDEO_SCALE_H
+#define X264_FILTER_VIDEO_SCALE_H
+
+#include "common/base.h"
+
+#define COEF_BITS 14
+
+/* The horizontal pass keeps HSHIFT fewer fractional bits than the coefficients
+ * and the vertical pass removes the rest; the intermediate then fits the
+ * vertical sums in 32 bits even with the ringing of the sharper kernels. */
+#define HSHIFT(high) ((high) ? COEF_BITS : COEF_BITS - 7)
+
+typedef struct
+{
+    const char *name;
+    double radius;
+    double (*func)( double x );
+} scale_method_t;
+
+/* Separable filter for one dimension of one plane: output sample i is
+ * the sum of coef[i*taps+t] * input[pos[i]+t] for t < taps. */
+typedef struct
+{
+    int taps;
+    int *pos;
+    int16_t *coef;
+} scale_kernel_t;
+
+typedef struct
+{
+    int comps;          /* interleaved components per pixel */
+    int src_width;      /* in pixels */
+    int src_height;
+    int dst_width;
+    int dst_height;
+    scale_kernel_t h;
+    scale_kernel_t v;
+    int32_t *tmp;       /* horizontally scaled plane, src_height rows of dst_width*comps */
+} scale_plane_t;
+
+extern const scale_method_t x264_scale_methods[];
+
+int  x264_scale_init_kernel( scale_kernel_t *k, const scale_method_t *method, int src_len, int dst_len, double offset );
+void x264_scale_h_8( int32_t *dst, uint8_t *src, int stride, int rows, scale_plane_t *p, int shift );
+void x264_scale_h_16( int32_t *dst, uint16_t *src, int stride, int rows, scale_plane_t *p, int shift );
+void x264_scale_v_8( uint8_t *dst, int stride, int y0, int y1, scale_plane_t *p, int shift );
+void x264_scale_v_16( uint16_t *dst, int stride, int y0, int y1, scale_plane_t *p, int shift );
+
+#endif
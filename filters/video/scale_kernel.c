@@ -0,0 +1,165 @@
+/*****************************************************************************
+ * scale_kernel.c: native resize video filter kernels
+ *****************************************************************************
+ * Copyright (C) 2010-2025 x264 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at licensing@x264.com.
+ *****************************************************************************/
+
+#include "scale.h"
+#include <math.h>
+
+static double bilinear( double x )
+{
+    return 1 - x;
+}
+
+/* Catmull-Rom */
+static double bicubic( double x )
+{
+    if( x < 1 )
+        return (1.5 * x - 2.5) * x * x + 1;
+    return ((-0.5 * x + 2.5) * x - 4) * x + 2;
+}
+
+static double lanczos( double x )
+{
+    if( x < 1e-8 )
+        return 1;
+    return 3 * sin( M_PI * x ) * sin( M_PI * x / 3 ) / (M_PI * M_PI * x * x);
+}
+
+/* spline36 */
+static double spline( double x )
+{
+    if( x < 1 )
+        return ((13./11 * x - 453./209) * x - 3./209) * x + 1;
+    if( x < 2 )
+        return ((-6./11 * (x-1) + 270./209) * (x-1) - 156./209) * (x-1);
+    return ((1./11 * (x-2) - 45./209) * (x-2) + 26./209) * (x-2);
+}
+
+const scale_method_t x264_scale_methods[] =
+{
+    { "bilinear", 1, bilinear },
+    { "bicubic",  2, bicubic },
+    { "lanczos",  3, lanczos },
+    { "spline",   3, spline },
+    { 0 }
+};
+
+/* Precompute the filter scaling src_len samples to dst_len. offset is the
+ * position of the first sample relative to the area it covers, in samples:
+ * 0.5 for samples centered in it, 0.25 for 4:2:x chroma co-sited with the
+ * left luma sample. Taps outside the input are folded onto the edge samples. */
+int x264_scale_init_kernel( scale_kernel_t *k, const scale_method_t *method, int src_len, int dst_len, double offset )
+{
+    double scale = (double)src_len / dst_len;
+    double fscale = X264_MAX( scale, 1.0 );
+    double support = method->radius * fscale;
+    if( src_len == dst_len )
+        k->taps = 1;
+    else
+        k->taps = X264_MIN( (int)ceil( support ) * 2, src_len );
+
+    k->pos = malloc( dst_len * sizeof(int) );
+    k->coef = calloc( dst_len * k->taps, sizeof(int16_t) );
+    double *weight = malloc( k->taps * sizeof(double) );
+    if( !k->pos || !k->coef || !weight )
+    {
+        free( weight );
+        return -1;
+    }
+
+    for( int i = 0; i < dst_len; i++ )
+    {
+        double center = (i + offset) * scale - offset;
+        int first = k->taps == 1 ? i : (int)floor( center - support ) + 1;
+        int start = x264_clip3( first, 0, src_len - k->taps );
+        double sum = 0;
+        for( int t = 0; t < k->taps; t++ )
+            weight[t] = 0;
+        for( int t = 0; t < (k->taps == 1 ? 1 : (int)ceil( support ) * 2); t++ )
+        {
+            double x = fabs( first + t - center ) / fscale;
+            double w = k->taps == 1 ? 1 : x < method->radius ? method->func( x ) : 0;
+            weight[x264_clip3( first + t, 0, src_len - 1 ) - start] += w;
+            sum += w;
+        }
+        /* Quantize, putting the rounding error on the largest tap so that each
+         * filter sums to exactly 1.0. */
+        int isum = 0, max_t = 0;
+        int16_t *coef = k->coef + i * k->taps;
+        for( int t = 0; t < k->taps; t++ )
+        {
+            coef[t] = lrint( weight[t] / sum * (1 << COEF_BITS) );
+            isum += coef[t];
+            if( abs( coef[t] ) > abs( coef[max_t] ) )
+                max_t = t;
+        }
+        coef[max_t] += (1 << COEF_BITS) - isum;
+        k->pos[i] = start;
+    }
+    free( weight );
+    return 0;
+}
+
+#define SCALE_FUNCS( name, pixel, pixel_max )\
+void x264_scale_h_##name( int32_t *dst, pixel *src, int stride, int rows, scale_plane_t *p, int shift )\
+{\
+    int taps = p->h.taps;\
+    int comps = p->comps;\
+    int rnd = (1 << shift) >> 1;\
+    for( int y = 0; y < rows; y++, dst += p->dst_width*comps, src += stride )\
+        for( int x = 0; x < p->dst_width; x++ )\
+        {\
+            pixel *s = src + p->h.pos[x] * comps;\
+            int16_t *coef = p->h.coef + x * taps;\
+            for( int c = 0; c < comps; c++ )\
+            {\
+                int sum = 0;\
+                for( int t = 0; t < taps; t++ )\
+                    sum += coef[t] * s[t*comps+c];\
+                dst[x*comps+c] = (sum + rnd) >> shift;\
+            }\
+        }\
+}\
+\
+void x264_scale_v_##name( pixel *dst, int stride, int y0, int y1, scale_plane_t *p, int shift )\
+{\
+    int taps = p->v.taps;\
+    int width = p->dst_width * p->comps;\
+    int rnd = 1 << (shift - 1);\
+    for( int y = y0; y < y1; y++, dst += stride )\
+    {\
+        int32_t *src = p->tmp + p->v.pos[y] * width;\
+        int16_t *coef = p->v.coef + y * taps;\
+        for( int x = 0; x < width; x++ )\
+        {\
+            int sum = rnd;\
+            for( int t = 0; t < taps; t++ )\
+                sum += coef[t] * src[t*width+x];\
+            dst[x] = x264_clip3( sum >> shift, 0, pixel_max );\
+        }\
+    }\
+}
+
+SCALE_FUNCS( 8, uint8_t, 255 )
+SCALE_FUNCS( 16, uint16_t, 65535 )
+
+#undef SCALE_FUNCS
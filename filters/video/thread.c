@@ -0,0 +1,246 @@
+/*****************************************************************************
+ * thread.c: threaded video filter stage
+ *****************************************************************************
+ * Copyright (C) 2010-2025 x264 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at licensing@x264.com.
+ *****************************************************************************/
+
+#include "video.h"
+#include "internal.h"
+#include "common/threadpool.h"
+
+#define NAME "thread"
+
+/* Runs the previous filter in a worker thread of its own, which copies its
+ * output frames, in order, into a queue of up to max_size frames. Filters keep
+ * state between frames, so each stage gets one thread; a chain of stages then
+ * runs as a pipeline. Frames stay queued after they're released or skipped
+ * over until the worker needs their slot, so that a request that goes back
+ * within the queue (e.g. a select_every pattern such as 3,2,1,0) is served
+ * from it instead of restarting the worker. */
+typedef struct
+{
+    hnd_t prev_hnd;
+    cli_vid_filter_t prev_filter;
+    x264_threadpool_t *pool;
+    int frame_total;
+
+    x264_pthread_mutex_t mutex;
+    x264_pthread_cond_t cv_fill;   /* signaled when a frame is queued or the worker stops */
+    x264_pthread_cond_t cv_space;  /* signaled when a slot is freed or the worker should stop */
+    cli_pic_t *pic;
+    int *status;
+    int *in_use;        /* the frame in the slot has been got and not released */
+    int max_size;
+    int head;           /* slot of the oldest queued frame */
+    int count;          /* number of queued frames */
+    int read_frame;     /* next frame the worker will filter */
+    int last_frame;     /* latest frame asked for: those before it not in use can go */
+    int b_running;      /* the worker is still filtering */
+    int b_stop;
+    int b_job;          /* the worker has been started and not waited for */
+
+    /* stats */
+    int frames;
+    int starved;        /* frames that had to be waited for */
+    int64_t wait_time;
+} thread_hnd_t;
+
+cli_vid_filter_t thread_filter;
+
+static int init( hnd_t *handle, cli_vid_filter_t *filter, video_info_t *info, x264_param_t *param, char *opt_string )
+{
+    intptr_t size = (intptr_t)opt_string;
+    /* upon a <= 0 queue request, do nothing */
+    if( size <= 0 )
+        return 0;
+    thread_hnd_t *h = calloc( 1, sizeof(thread_hnd_t) );
+    if( !h )
+        return -1;
+
+    h->max_size = size;
+    h->frame_total = info->num_frames;
+    h->pic = calloc( h->max_size, sizeof(cli_pic_t) );
+    h->status = calloc( h->max_size, sizeof(int) );
+    h->in_use = calloc( h->max_size, sizeof(int) );
+    if( !h->pic || !h->status || !h->in_use )
+        return -1;
+    for( int i = 0; i < h->max_size; i++ )
+        if( x264_cli_pic_alloc( &h->pic[i], info->csp, info->width, info->height ) )
+            return -1;
+
+    if( x264_pthread_mutex_init( &h->mutex, NULL ) ||
+        x264_pthread_cond_init( &h->cv_fill, NULL ) ||
+        x264_pthread_cond_init( &h->cv_space, NULL ) ||
+        x264_threadpool_init( &h->pool, 1 ) )
+        return -1;
+
+    h->prev_filter = *filter;
+    h->prev_hnd = *handle;
+    *handle = h;
+    *filter = thread_filter;
+
+    return 0;
+}
+
+/* Drop the oldest queued frame if it's no longer needed. Called with the mutex held. */
+static int drop_oldest( thread_hnd_t *h )
+{
+    if( !h->count || h->in_use[h->head] || h->read_frame - h->count >= h->last_frame )
+        return 0;
+    h->head = (h->head + 1) % h->max_size;
+    h->count--;
+    return 1;
+}
+
+static void *filter_frames_thread( thread_hnd_t *h )
+{
+    x264_pthread_mutex_lock( &h->mutex );
+    while( !h->frame_total || h->read_frame < h->frame_total )
+    {
+        while( h->count == h->max_size && !drop_oldest( h ) && !h->b_stop )
+            x264_pthread_cond_wait( &h->cv_space, &h->mutex );
+        if( h->b_stop )
+            break;
+        /* Only the worker touches slots past the queued ones. */
+        int slot = (h->head + h->count) % h->max_size;
+        int frame = h->read_frame;
+        x264_pthread_mutex_unlock( &h->mutex );
+
+        cli_pic_t temp;
+        int status = h->prev_filter.get_frame( h->prev_hnd, &temp, frame ) ||
+                     x264_cli_pic_copy( &h->pic[slot], &temp ) ||
+                     h->prev_filter.release_frame( h->prev_hnd, &temp, frame );
+
+        x264_pthread_mutex_lock( &h->mutex );
+        h->status[slot] = status;
+        h->in_use[slot] = 0;
+        h->count++;
+        h->read_frame++;
+        x264_pthread_cond_broadcast( &h->cv_fill );
+        if( status )
+            break;
+    }
+    h->b_running = 0;
+    x264_pthread_cond_broadcast( &h->cv_fill );
+    x264_pthread_mutex_unlock( &h->mutex );
+    return NULL;
+}
+
+/* Stop the worker and drop what it has queued. Called with the mutex held. */
+static void stop_worker( thread_hnd_t *h )
+{
+    if( h->b_job )
+    {
+        h->b_stop = 1;
+        x264_pthread_cond_broadcast( &h->cv_space );
+        x264_pthread_mutex_unlock( &h->mutex );
+        x264_threadpool_wait( h->pool, h );
+        x264_pthread_mutex_lock( &h->mutex );
+        h->b_stop = 0;
+        h->b_job = 0;
+    }
+    h->head = (h->head + h->count) % h->max_size;
+    h->count = 0;
+}
+
+static int get_frame( hnd_t handle, cli_pic_t *output, int frame )
+{
+    thread_hnd_t *h = handle;
+    int ret = -1;
+
+    x264_pthread_mutex_lock( &h->mutex );
+    /* Frames are filtered in order from the first one asked for; only a
+     * request for a frame that is no longer queued restarts the worker. */
+    if( !h->b_job || frame < h->read_frame - h->count )
+    {
+        stop_worker( h );
+        h->read_frame = h->last_frame = frame;
+        h->b_running = h->b_job = 1;
+        x264_threadpool_run( h->pool, (void*)filter_frames_thread, h );
+    }
+    if( frame > h->last_frame )
+    {
+        /* The frames skipped over may now make way for new ones. */
+        h->last_frame = frame;
+        x264_pthread_cond_broadcast( &h->cv_space );
+    }
+
+    int64_t start = 0;
+    while( frame >= h->read_frame && h->b_running )
+    {
+        if( !start )
+            start = x264_mdate();
+        x264_pthread_cond_wait( &h->cv_fill, &h->mutex );
+    }
+    if( start )
+        h->wait_time += x264_mdate() - start;
+
+    /* The frame stays queued, and so untouched by the worker, until it's released. */
+    int slot = (h->head + frame - (h->read_frame - h->count)) % h->max_size;
+    if( frame < h->read_frame && !h->status[slot] )
+    {
+        *output = h->pic[slot];
+        h->in_use[slot] = 1;
+        h->frames++;
+        h->starved += !!start;
+        ret = 0;
+    }
+    x264_pthread_mutex_unlock( &h->mutex );
+
+    return ret;
+}
+
+static int release_frame( hnd_t handle, cli_pic_t *pic, int frame )
+{
+    thread_hnd_t *h = handle;
+    x264_pthread_mutex_lock( &h->mutex );
+    int first = h->read_frame - h->count;
+    if( frame >= first && frame < h->read_frame )
+    {
+        h->in_use[(h->head + frame - first) % h->max_size] = 0;
+        x264_pthread_cond_broadcast( &h->cv_space );
+    }
+    x264_pthread_mutex_unlock( &h->mutex );
+    return 0;
+}
+
+static void free_filter( hnd_t handle )
+{
+    thread_hnd_t *h = handle;
+    x264_pthread_mutex_lock( &h->mutex );
+    stop_worker( h );
+    x264_pthread_mutex_unlock( &h->mutex );
+    if( h->frames )
+        x264_cli_log( "thread", X264_LOG_INFO, "filter queue after %s: waited for %d of %d frames, %.2fs total\n",
+                      h->prev_filter.name, h->starved, h->frames, h->wait_time / 1e6 );
+    x264_threadpool_delete( h->pool );
+    x264_pthread_cond_destroy( &h->cv_space );
+    x264_pthread_cond_destroy( &h->cv_fill );
+    x264_pthread_mutex_destroy( &h->mutex );
+    h->prev_filter.free( h->prev_hnd );
+    for( int i = 0; i < h->max_size; i++ )
+        x264_cli_pic_clean( &h->pic[i] );
+    free( h->in_use );
+    free( h->status );
+    free( h->pic );
+    free( h );
+}
+
+cli_vid_filter_t thread_filter = { NAME, NULL, init, get_frame, release_frame, free_filter, NULL };
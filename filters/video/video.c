@@ -56,8 +56,13 @@ void x264_register_vid_filters( void )
 #endif
     REGISTER_VFILTER( crop );
     REGISTER_VFILTER( fix_vfr_pts );
+    REGISTER_VFILTER( fork );
     REGISTER_VFILTER( resize );
+    REGISTER_VFILTER( scale );
     REGISTER_VFILTER( select_every );
+#if HAVE_THREAD
+    REGISTER_VFILTER( thread );
+#endif
 #if HAVE_GPL
 #endif
 }
@@ -31,6 +31,7 @@
 #elif HAVE_MMAP
 #include <sys/mman.h>
 #include <unistd.h>
+#include <fcntl.h>
 #endif
 
 const x264_cli_csp_t x264_cli_csps[] = {
@@ -146,6 +147,21 @@ const x264_cli_csp_t *x264_cli_get_csp( int csp )
     return x264_cli_csps + (csp&X264_CSP_MASK);
 }
 
+/* Pipes hand over at most their buffer size per read, 64KiB by default on Linux,
+ * which makes for a lot of round trips with the writer on uncompressed video. */
+#define PIPE_BUFFER_SIZE (1<<20)
+
+void x264_cli_pipe_init( FILE *fh )
+{
+    if( x264_is_regular_file( fh ) )
+        return;
+#ifdef F_SETPIPE_SZ
+    /* Fails harmlessly beyond the system's maximum. */
+    fcntl( fileno( fh ), F_SETPIPE_SZ, PIPE_BUFFER_SIZE );
+#endif
+    setvbuf( fh, NULL, _IOFBF, PIPE_BUFFER_SIZE );
+}
+
 /* Functions for handling memory-mapped input frames */
 int x264_cli_mmap_init( cli_mmap_t *h, FILE *fh )
 {
@@ -171,6 +187,10 @@ int x264_cli_mmap_init( cli_mmap_t *h, FILE *fh )
 #elif HAVE_MMAP && defined(_SC_PAGESIZE)
         h->align_mask = sysconf( _SC_PAGESIZE ) - 1;
         h->fd = fd;
+        h->prefetch_end = 0;
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
         return h->align_mask < 0 || fd < 0;
 #endif
     }
@@ -182,6 +202,9 @@ int x264_cli_mmap_init( cli_mmap_t *h, FILE *fh )
  * in segfaults. We have to pad the buffer size as a workaround to avoid that. */
 #define MMAP_PADDING 64
 
+/* How far past the last mapped frame to keep reading into the page cache, at least two frames. */
+#define MMAP_PREFETCH_SIZE (64<<20)
+
 void *x264_cli_mmap( cli_mmap_t *h, int64_t offset, int64_t size )
 {
 #if defined(_WIN32) || HAVE_MMAP
@@ -237,6 +260,18 @@ void *x264_cli_mmap( cli_mmap_t *h, int64_t offset, int64_t size )
         madvise( base, size, MADV_WILLNEED );
 #elif defined(POSIX_MADV_WILLNEED)
         posix_madvise( base, size, POSIX_MADV_WILLNEED );
+#endif
+#ifdef POSIX_FADV_WILLNEED
+        /* That only covers this frame, so the next ones would still be read when first
+         * touched. Have the kernel read ahead of them in the background instead. */
+        int64_t end = offset + size;
+        int64_t prefetch_start = X264_MAX( end, h->prefetch_end );
+        int64_t prefetch_end = X264_MIN( end + X264_MAX( 2 * size, MMAP_PREFETCH_SIZE ), h->file_size );
+        if( prefetch_end > prefetch_start )
+        {
+            posix_fadvise( h->fd, prefetch_start, prefetch_end - prefetch_start, POSIX_FADV_WILLNEED );
+            h->prefetch_end = prefetch_end;
+        }
 #endif
         /* Remap the file mapping of any padding that crosses a page boundary past the end of
          * the file into a copy of the last valid page to prevent reads from invalid memory. */
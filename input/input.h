@@ -48,6 +48,7 @@ typedef struct
     int output_csp; /* convert to this csp, if applicable */
     int output_range; /* user desired output range */
     int input_range; /* user override input range */
+    int queue_size; /* number of frames threaded input reads ahead */
 } cli_input_opt_t;
 
 /* properties of the source given by the demuxer */
@@ -102,8 +103,7 @@ typedef struct
 extern const cli_input_t raw_input;
 extern const cli_input_t y4m_input;
 extern const cli_input_t avs_input;
-extern const cli_input_t thread_8_input;
-extern const cli_input_t thread_10_input;
+extern const cli_input_t thread_input;
 extern const cli_input_t lavf_input;
 extern const cli_input_t ffms_input;
 extern const cli_input_t timecode_input;
@@ -147,9 +147,12 @@ typedef struct
     HANDLE map_handle;
 #elif HAVE_MMAP
     int fd;
+    int64_t prefetch_end; /* end of the range already being read ahead */
 #endif
 } cli_mmap_t;
 
+void x264_cli_pipe_init( FILE *fh );
+
 int x264_cli_mmap_init( cli_mmap_t *h, FILE *fh );
 void *x264_cli_mmap( cli_mmap_t *h, int64_t offset, int64_t size );
 int x264_cli_munmap( cli_mmap_t *h, void *addr, int64_t size );
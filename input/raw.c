@@ -79,6 +79,7 @@ static int open_file( char *psz_filename, hnd_t *p_handle, video_info_t *info, c
         h->fh = x264_fopen( psz_filename, "rb" );
     if( h->fh == NULL )
         return -1;
+    x264_cli_pipe_init( h->fh );
 
     info->thread_safe = 1;
     info->num_frames  = 0;
@@ -25,85 +25,163 @@
  *****************************************************************************/
 
 #include "input.h"
-#include "common/common.h"
-
-#define thread_input x264_glue3(thread, BIT_DEPTH, input)
+#include "common/threadpool.h"
 
+/* A reader thread decodes frames in order into a ring of up to queue_size
+ * pictures, ahead of the frame the encoder asks for. The demuxers aren't
+ * reentrant, so a single thread does all the reading. */
 typedef struct
 {
     cli_input_t input;
     hnd_t p_handle;
-    cli_pic_t pic;
     x264_threadpool_t *pool;
-    int next_frame;
     int frame_total;
-    struct thread_input_arg_t *next_args;
-} thread_hnd_t;
 
-typedef struct thread_input_arg_t
-{
-    thread_hnd_t *h;
+    x264_pthread_mutex_t mutex;
+    x264_pthread_cond_t cv_fill;   /* signaled when a frame is queued or the reader stops */
+    x264_pthread_cond_t cv_space;  /* signaled when a slot is freed or the reader should stop */
     cli_pic_t *pic;
-    int i_frame;
-    int status;
-} thread_input_arg_t;
+    int *status;
+    int queue_size;
+    int head;           /* slot of the oldest queued frame */
+    int count;          /* number of queued frames */
+    int next_frame;     /* frame number of the oldest queued frame */
+    int read_frame;     /* next frame the reader will read */
+    int b_running;      /* the reader is still reading */
+    int b_stop;
+    int b_job;          /* the reader has been started and not waited for */
+
+    /* stats */
+    int frames;
+    int starved;        /* frames the encoder had to wait for */
+    int64_t wait_time;
+} thread_hnd_t;
 
 static int open_file( char *psz_filename, hnd_t *p_handle, video_info_t *info, cli_input_opt_t *opt )
 {
-    thread_hnd_t *h = malloc( sizeof(thread_hnd_t) );
-    FAIL_IF_ERR( !h || cli_input.picture_alloc( &h->pic, *p_handle, info->csp, info->width, info->height ),
-                 "x264", "malloc failed\n" );
+    thread_hnd_t *h = calloc( 1, sizeof(thread_hnd_t) );
+    FAIL_IF_ERR( !h, "x264", "malloc failed\n" );
     h->input = cli_input;
     h->p_handle = *p_handle;
-    h->next_frame = -1;
-    h->next_args = malloc( sizeof(thread_input_arg_t) );
-    if( !h->next_args )
-        return -1;
-    h->next_args->h = h;
-    h->next_args->status = 0;
     h->frame_total = info->num_frames;
-
-    if( x264_threadpool_init( &h->pool, 1 ) )
+    h->queue_size = opt && opt->queue_size > 0 ? opt->queue_size : 1;
+    h->next_frame = -1;
+    h->pic = calloc( h->queue_size, sizeof(cli_pic_t) );
+    h->status = calloc( h->queue_size, sizeof(int) );
+    FAIL_IF_ERR( !h->pic || !h->status, "x264", "malloc failed\n" );
+    for( int i = 0; i < h->queue_size; i++ )
+        FAIL_IF_ERR( cli_input.picture_alloc( &h->pic[i], *p_handle, info->csp, info->width, info->height ),
+                     "x264", "malloc failed\n" );
+
+    if( x264_pthread_mutex_init( &h->mutex, NULL ) ||
+        x264_pthread_cond_init( &h->cv_fill, NULL ) ||
+        x264_pthread_cond_init( &h->cv_space, NULL ) ||
+        x264_threadpool_init( &h->pool, 1 ) )
         return -1;
 
     *p_handle = h;
     return 0;
 }
 
-static void read_frame_thread_int( thread_input_arg_t *i )
+static void *read_frames_thread( thread_hnd_t *h )
 {
-    i->status = i->h->input.read_frame( i->pic, i->h->p_handle, i->i_frame );
+    x264_pthread_mutex_lock( &h->mutex );
+    while( !h->frame_total || h->read_frame < h->frame_total )
+    {
+        while( h->count == h->queue_size && !h->b_stop )
+            x264_pthread_cond_wait( &h->cv_space, &h->mutex );
+        if( h->b_stop )
+            break;
+        /* Only the reader touches slots past the queued ones. */
+        int slot = (h->head + h->count) % h->queue_size;
+        int i_frame = h->read_frame;
+        x264_pthread_mutex_unlock( &h->mutex );
+
+        int status = h->input.read_frame( &h->pic[slot], h->p_handle, i_frame );
+
+        x264_pthread_mutex_lock( &h->mutex );
+        h->status[slot] = status;
+        h->count++;
+        h->read_frame++;
+        x264_pthread_cond_broadcast( &h->cv_fill );
+        if( status )
+            break;
+    }
+    h->b_running = 0;
+    x264_pthread_cond_broadcast( &h->cv_fill );
+    x264_pthread_mutex_unlock( &h->mutex );
+    return NULL;
+}
+
+static int release_frame( cli_pic_t *pic, hnd_t handle );
+
+/* Stop the reader and drop what it has queued. Called with the mutex held. */
+static void stop_reader( thread_hnd_t *h )
+{
+    if( h->b_job )
+    {
+        h->b_stop = 1;
+        x264_pthread_cond_broadcast( &h->cv_space );
+        x264_pthread_mutex_unlock( &h->mutex );
+        x264_threadpool_wait( h->pool, h );
+        x264_pthread_mutex_lock( &h->mutex );
+        h->b_stop = 0;
+        h->b_job = 0;
+    }
+    for( ; h->count; h->count-- )
+    {
+        if( !h->status[h->head] )
+            release_frame( &h->pic[h->head], h );
+        h->head = (h->head + 1) % h->queue_size;
+    }
 }
 
 static int read_frame( cli_pic_t *p_pic, hnd_t handle, int i_frame )
 {
     thread_hnd_t *h = handle;
-    int ret = 0;
+    int ret;
 
-    if( h->next_frame >= 0 )
+    x264_pthread_mutex_lock( &h->mutex );
+    /* The encoder reads frames in order, so this only happens on the first
+     * frame, which may not be frame 0. */
+    if( i_frame != h->next_frame )
     {
-        x264_threadpool_wait( h->pool, h->next_args );
-        ret |= h->next_args->status;
+        stop_reader( h );
+        h->next_frame = h->read_frame = i_frame;
+        h->b_running = h->b_job = 1;
+        x264_threadpool_run( h->pool, (void*)read_frames_thread, h );
     }
 
-    if( h->next_frame == i_frame )
-        XCHG( cli_pic_t, *p_pic, h->pic );
-    else
+    int64_t wait_time = 0;
+    int b_waited = !h->count && h->b_running;
+    if( b_waited )
     {
-        if( h->next_frame >= 0 )
-            thread_input.release_frame( &h->pic, handle );
-        ret |= h->input.read_frame( p_pic, h->p_handle, i_frame );
+        int64_t start = x264_mdate();
+        while( !h->count && h->b_running )
+            x264_pthread_cond_wait( &h->cv_fill, &h->mutex );
+        wait_time = x264_mdate() - start;
     }
 
-    if( !h->frame_total || i_frame+1 < h->frame_total )
+    if( h->count )
     {
-        h->next_frame =
-        h->next_args->i_frame = i_frame+1;
-        h->next_args->pic = &h->pic;
-        x264_threadpool_run( h->pool, (void*)read_frame_thread_int, h->next_args );
+        XCHG( cli_pic_t, *p_pic, h->pic[h->head] );
+        ret = h->status[h->head];
+        h->head = (h->head + 1) % h->queue_size;
+        h->count--;
+        h->next_frame++;
+        x264_pthread_cond_broadcast( &h->cv_space );
+        /* Only count frames actually returned, not the read that hit the end.
+         * The first frame always has to be waited for. */
+        if( !ret )
+        {
+            h->wait_time += wait_time;
+            h->starved += b_waited && h->frames > 0;
+            h->frames++;
+        }
     }
     else
-        h->next_frame = -1;
+        ret = -1;
+    x264_pthread_mutex_unlock( &h->mutex );
 
     return ret;
 }
@@ -131,10 +209,21 @@ static void picture_clean( cli_pic_t *pic, hnd_t handle )
 static int close_file( hnd_t handle )
 {
     thread_hnd_t *h = handle;
+    x264_pthread_mutex_lock( &h->mutex );
+    stop_reader( h );
+    x264_pthread_mutex_unlock( &h->mutex );
+    if( h->frames > 1 )
+        x264_cli_log( "thread", X264_LOG_INFO, "input queue of %d: waited for %d of %d frames after the first, %.2fs total\n",
+                      h->queue_size, h->starved, h->frames - 1, h->wait_time / 1e6 );
     x264_threadpool_delete( h->pool );
-    h->input.picture_clean( &h->pic, h->p_handle );
+    x264_pthread_cond_destroy( &h->cv_space );
+    x264_pthread_cond_destroy( &h->cv_fill );
+    x264_pthread_mutex_destroy( &h->mutex );
+    for( int i = 0; i < h->queue_size; i++ )
+        h->input.picture_clean( &h->pic[i], h->p_handle );
     h->input.close_file( h->p_handle );
-    free( h->next_args );
+    free( h->status );
+    free( h->pic );
     free( h );
     return 0;
 }
@@ -88,6 +88,7 @@ static int open_file( char *psz_filename, hnd_t *p_handle, video_info_t *info, c
         h->fh = x264_fopen(psz_filename, "rb");
     if( h->fh == NULL )
         return -1;
+    x264_cli_pipe_init( h->fh );
 
     /* Read header */
     for( i = 0; i < Y4M_MAX_HEADER; i++ )
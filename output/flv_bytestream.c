@@ -100,6 +100,7 @@ flv_buffer *flv_create_writer( const char *filename )
         free( c );
         return NULL;
     }
+    setvbuf( c->fp, NULL, _IOFBF, OUTPUT_BUFFER_SIZE );
 
     return c;
 }
@@ -0,0 +1,688 @@
+/*****************************************************************************
+ * fmp4.c: fragmented mp4 (cmaf) muxer
+ *****************************************************************************
+ * Copyright (C) 2025 x264 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at licensing@x264.com.
+ *****************************************************************************/
+
+#include "output.h"
+#include "fmp4_bytestream.h"
+
+#define FMP4_LOG_ERROR( ... ) x264_cli_log( "fmp4", X264_LOG_ERROR, __VA_ARGS__ )
+
+/* A fragment is written early, in the middle of a segment, once it holds this
+ * much data or time, so that a long or endless GOP (--keyint infinite) doesn't
+ * have to be held in memory whole. */
+#define FMP4_CHUNK_SIZE     (8 << 20)
+#define FMP4_CHUNK_DURATION 10.0
+
+#define CHECK(x)\
+do {\
+    if( (x) < 0 )\
+        return -1;\
+} while( 0 )
+
+/* The movie is written as an initialization segment (ftyp and moov, with no
+ * samples) followed by one fragment (moof and mdat) per keyframe, or per the
+ * first keyframe at or past each multiple of fragment_duration seconds, plus
+ * one whenever the held samples reach the chunk limits above. Only the samples
+ * of the current fragment are held, so memory use doesn't grow with the encode.
+ * Fragments go to the output file, or, if the output name is a pattern such as
+ * seg%05d.m4s, to a segment file per keyframe cut; the initialization
+ * segment is then written to the name with "init" in place of the number, and
+ * an HLS playlist, if asked for, to the name without the number and with an
+ * m3u8 extension (seg.m3u8). */
+typedef struct
+{
+    int64_t dts;
+    int64_t pts;
+    uint32_t size;
+    int b_sync;
+} fmp4_sample_t;
+
+typedef struct
+{
+    FILE *fp;                   /* with a pattern, the open segment, if any */
+    char *pattern;
+    int i_segment;
+    int64_t i_segment_dts;      /* where the open segment starts */
+
+    /* hls */
+    char *playlist;
+    int i_list_size;
+    int b_independent;          /* every segment starts with an IDR frame */
+    double *segment_duration;   /* seconds, indexed by segment number - 1 */
+    int i_segments_max;
+
+    fmp4_buffer box;
+    fmp4_buffer mdat;
+
+    fmp4_sample_t *samples;
+    int i_samples;
+    int i_samples_max;
+    uint32_t i_sequence;
+
+    uint8_t *sei;
+    int sei_len;
+
+    int width, height;
+    int sar_width, sar_height;
+    int chroma_format;
+    int bit_depth;
+
+    uint32_t i_timebase_num;
+    uint32_t i_timebase_den;
+    double d_fragment_duration;
+    int64_t i_fragment_duration;
+    int64_t i_frame_duration;
+    int64_t i_chunk_duration;
+    int64_t i_next_cut;
+
+    int b_first_frame;
+    int64_t i_first_dts;
+    int64_t i_delay;
+} fmp4_hnd_t;
+
+/* Returns the number of conversions in the name if it is a segment pattern:
+ * one %d, optionally with a zero-padded width, is allowed. */
+static int count_conversions( const char *name )
+{
+    int count = 0;
+    for( const char *p = strchr( name, '%' ); p; p = strchr( p, '%' ) )
+    {
+        p++;
+        if( *p == '0' )
+            p++;
+        while( *p >= '0' && *p <= '9' )
+            p++;
+        if( *p++ != 'd' )
+            return -1;
+        count++;
+    }
+    return count;
+}
+
+/* The file name of a segment, or of the initialization segment if i_segment < 0. */
+static void segment_name( fmp4_hnd_t *p_fmp4, int i_segment, char *name, int size )
+{
+    if( i_segment < 0 )
+    {
+        const char *conv = strchr( p_fmp4->pattern, '%' );
+        const char *end = strchr( conv, 'd' ) + 1;
+        snprintf( name, size, "%.*sinit%s", (int)(conv - p_fmp4->pattern), p_fmp4->pattern, end );
+    }
+    else
+        snprintf( name, size, p_fmp4->pattern, i_segment );
+}
+
+static FILE *open_segment( fmp4_hnd_t *p_fmp4, int i_segment )
+{
+    char name[4096];
+    segment_name( p_fmp4, i_segment, name, sizeof(name) );
+    FILE *fp = x264_fopen( name, "wb" );
+    if( !fp )
+        FMP4_LOG_ERROR( "could not open segment file `%s'\n", name );
+    return fp;
+}
+
+/* seg%05d.m4s -> seg.m3u8 */
+static char *playlist_name( const char *pattern )
+{
+    const char *conv = strchr( pattern, '%' );
+    const char *end = strchr( conv, 'd' ) + 1;
+    char *name = malloc( strlen( pattern ) + 16 );
+    if( !name )
+        return NULL;
+    sprintf( name, "%.*s%s", (int)(conv - pattern), pattern, end );
+    char *base = strrchr( name, '/' );
+    base = base ? base + 1 : name;
+    char *ext = strrchr( base, '.' );
+    if( !ext )
+        ext = base + strlen( base );
+    if( ext == base )
+        ext += sprintf( ext, "index" );
+    strcpy( ext, ".m3u8" );
+    return name;
+}
+
+/* Rewrite the playlist with the segments written so far, or the last
+ * i_list_size of them. It is replaced rather than rewritten in place, so that
+ * a reader never sees it partly written. */
+static int write_playlist( fmp4_hnd_t *p_fmp4, int b_end )
+{
+    int i_segments = p_fmp4->i_segment - 1;
+    int i_first = p_fmp4->i_list_size ? X264_MAX( i_segments - p_fmp4->i_list_size, 0 ) : 0;
+    char name[4096];
+    char tmp_name[4096];
+
+    /* Segments in the playlist's directory are listed by their bare names. */
+    const char *base = strrchr( p_fmp4->playlist, '/' );
+    int dir_len = base ? base + 1 - p_fmp4->playlist : 0;
+#define URI( name ) (strncmp( name, p_fmp4->playlist, dir_len ) ? name : name + dir_len)
+
+    int target = (int)ceil( p_fmp4->d_fragment_duration );
+    for( int i = i_first; i < i_segments; i++ )
+        target = X264_MAX( target, (int)(p_fmp4->segment_duration[i] + 0.5) );
+
+    snprintf( tmp_name, sizeof(tmp_name), "%s.tmp", p_fmp4->playlist );
+    FILE *fp = x264_fopen( tmp_name, "wb" );
+    FAIL_IF_ERR( !fp, "fmp4", "could not open playlist `%s'\n", tmp_name );
+    fprintf( fp, "#EXTM3U\n#EXT-X-VERSION:7\n#EXT-X-TARGETDURATION:%d\n", X264_MAX( target, 1 ) );
+    fprintf( fp, "#EXT-X-MEDIA-SEQUENCE:%d\n", i_first + 1 );
+    if( !p_fmp4->i_list_size )
+        fprintf( fp, "#EXT-X-PLAYLIST-TYPE:%s\n", b_end ? "VOD" : "EVENT" );
+    if( p_fmp4->b_independent )
+        fprintf( fp, "#EXT-X-INDEPENDENT-SEGMENTS\n" );
+    segment_name( p_fmp4, -1, name, sizeof(name) );
+    fprintf( fp, "#EXT-X-MAP:URI=\"%s\"\n", URI( name ) );
+    for( int i = i_first; i < i_segments; i++ )
+    {
+        segment_name( p_fmp4, i + 1, name, sizeof(name) );
+        fprintf( fp, "#EXTINF:%.3f,\n%s\n", p_fmp4->segment_duration[i], URI( name ) );
+    }
+    if( b_end )
+        fprintf( fp, "#EXT-X-ENDLIST\n" );
+#undef URI
+    int ret = ferror( fp );
+    ret |= fclose( fp );
+    FAIL_IF_ERR( ret || x264_rename( tmp_name, p_fmp4->playlist ), "fmp4", "could not write playlist `%s'\n", p_fmp4->playlist );
+    return 0;
+}
+
+static int open_file( char *psz_filename, hnd_t *p_handle, cli_output_opt_t *opt )
+{
+    *p_handle = NULL;
+    int conversions = count_conversions( psz_filename );
+    FAIL_IF_ERR( conversions < 0 || conversions > 1, "fmp4", "invalid segment pattern `%s': expected a single %%d\n", psz_filename );
+    FAIL_IF_ERR( opt->hls && !conversions, "fmp4", "HLS needs a segment pattern such as seg%%05d.m4s as output, not `%s'\n", psz_filename );
+
+    fmp4_hnd_t *p_fmp4 = calloc( 1, sizeof(fmp4_hnd_t) );
+    if( !p_fmp4 )
+        return -1;
+
+    if( conversions )
+    {
+        p_fmp4->pattern = strdup( psz_filename );
+        if( opt->hls )
+            p_fmp4->playlist = playlist_name( psz_filename );
+        if( !p_fmp4->pattern || (opt->hls && !p_fmp4->playlist) )
+        {
+            free( p_fmp4->pattern );
+            free( p_fmp4 );
+            return -1;
+        }
+        p_fmp4->i_list_size = opt->hls_list_size;
+    }
+    else
+    {
+        if( !strcmp( psz_filename, "-" ) )
+            p_fmp4->fp = stdout;
+        else if( (p_fmp4->fp = x264_fopen( psz_filename, "wb" )) )
+            setvbuf( p_fmp4->fp, NULL, _IOFBF, OUTPUT_BUFFER_SIZE );
+        else
+        {
+            free( p_fmp4 );
+            return -1;
+        }
+    }
+
+    p_fmp4->d_fragment_duration = opt->fragment_duration;
+    p_fmp4->i_segment = 1;
+    p_fmp4->b_first_frame = 1;
+
+    *p_handle = p_fmp4;
+
+    return 0;
+}
+
+static int set_param( hnd_t handle, x264_param_t *p_param )
+{
+    fmp4_hnd_t *p_fmp4 = handle;
+    int csp = p_param->i_csp & X264_CSP_MASK;
+
+    p_fmp4->width = p_param->i_width;
+    p_fmp4->height = p_param->i_height;
+    if( p_param->vui.i_sar_width && p_param->vui.i_sar_height )
+    {
+        p_fmp4->sar_width = p_param->vui.i_sar_width;
+        p_fmp4->sar_height = p_param->vui.i_sar_height;
+    }
+    p_fmp4->chroma_format = csp >= X264_CSP_I444 ? 3 : csp >= X264_CSP_I422 ? 2 : csp > X264_CSP_I400;
+    p_fmp4->bit_depth = p_param->i_bitdepth;
+
+    p_fmp4->i_timebase_num = p_param->i_timebase_num;
+    p_fmp4->i_timebase_den = p_param->i_timebase_den;
+    p_fmp4->i_fragment_duration = x264_cli_fragment_ticks( p_fmp4->d_fragment_duration, p_param );
+    p_fmp4->i_chunk_duration = x264_cli_fragment_ticks( X264_MAX( p_fmp4->d_fragment_duration, FMP4_CHUNK_DURATION ), p_param );
+    p_fmp4->b_independent = !p_param->b_open_gop && !p_param->b_intra_refresh;
+    if( p_param->i_fps_num > 0 )
+        p_fmp4->i_frame_duration = X264_MAX( (int64_t)p_param->i_fps_den * p_param->i_timebase_den
+                                             / ((int64_t)p_param->i_fps_num * p_param->i_timebase_num), 1 );
+    else
+        p_fmp4->i_frame_duration = 1;
+
+    return 0;
+}
+
+static const int32_t identity_matrix[9] = { 0x10000, 0, 0, 0, 0x10000, 0, 0, 0, 0x40000000 };
+
+static void put_matrix( fmp4_buffer *c )
+{
+    for( int i = 0; i < 9; i++ )
+        fmp4_put_be32( c, identity_matrix[i] );
+}
+
+static void write_avcc( fmp4_hnd_t *p_fmp4, uint8_t *sps, int sps_size, uint8_t *pps, int pps_size )
+{
+    fmp4_buffer *c = &p_fmp4->box;
+    unsigned avcc = fmp4_start_box( c, "avcC" );
+    fmp4_put_byte( c, 1 );      // configurationVersion
+    fmp4_put_byte( c, sps[1] ); // AVCProfileIndication
+    fmp4_put_byte( c, sps[2] ); // profile_compatibility
+    fmp4_put_byte( c, sps[3] ); // AVCLevelIndication
+    fmp4_put_byte( c, 0xff );   // nalu size length is four bytes
+    fmp4_put_byte( c, 0xe1 );   // one sps
+    fmp4_put_be16( c, sps_size );
+    fmp4_append_data( c, sps, sps_size );
+    fmp4_put_byte( c, 1 );      // one pps
+    fmp4_put_be16( c, pps_size );
+    fmp4_append_data( c, pps, pps_size );
+    if( sps[1] == 100 || sps[1] == 110 || sps[1] == 122 || sps[1] == 144 || sps[1] == 244 )
+    {
+        fmp4_put_byte( c, 0xfc | p_fmp4->chroma_format );
+        fmp4_put_byte( c, 0xf8 | (p_fmp4->bit_depth - 8) ); // luma
+        fmp4_put_byte( c, 0xf8 | (p_fmp4->bit_depth - 8) ); // chroma
+        fmp4_put_byte( c, 0 );  // no sps extensions
+    }
+    fmp4_end_box( c, avcc );
+}
+
+static void write_moov( fmp4_hnd_t *p_fmp4, uint8_t *sps, int sps_size, uint8_t *pps, int pps_size )
+{
+    fmp4_buffer *c = &p_fmp4->box;
+    uint32_t d_width = p_fmp4->width;
+    if( p_fmp4->sar_width && p_fmp4->sar_height )
+        d_width = (uint64_t)d_width * p_fmp4->sar_width / p_fmp4->sar_height;
+
+    unsigned moov = fmp4_start_box( c, "moov" );
+
+    unsigned mvhd = fmp4_start_full_box( c, "mvhd", 0, 0 );
+    fmp4_put_be32( c, 0 );                      // creation_time
+    fmp4_put_be32( c, 0 );                      // modification_time
+    fmp4_put_be32( c, p_fmp4->i_timebase_den ); // timescale
+    fmp4_put_be32( c, 0 );                      // duration: given by the fragments
+    fmp4_put_be32( c, 0x00010000 );             // rate
+    fmp4_put_be16( c, 0x0100 );                 // volume
+    fmp4_put_zero( c, 10 );                     // reserved
+    put_matrix( c );
+    fmp4_put_zero( c, 24 );                     // pre_defined
+    fmp4_put_be32( c, 2 );                      // next_track_ID
+    fmp4_end_box( c, mvhd );
+
+    unsigned trak = fmp4_start_box( c, "trak" );
+
+    unsigned tkhd = fmp4_start_full_box( c, "tkhd", 0, 3 ); // enabled, in movie
+    fmp4_put_be32( c, 0 );                      // creation_time
+    fmp4_put_be32( c, 0 );                      // modification_time
+    fmp4_put_be32( c, 1 );                      // track_ID
+    fmp4_put_be32( c, 0 );                      // reserved
+    fmp4_put_be32( c, 0 );                      // duration
+    fmp4_put_zero( c, 8 );                      // reserved
+    fmp4_put_be16( c, 0 );                      // layer
+    fmp4_put_be16( c, 0 );                      // alternate_group
+    fmp4_put_be16( c, 0 );                      // volume
+    fmp4_put_be16( c, 0 );                      // reserved
+    put_matrix( c );
+    fmp4_put_be32( c, d_width << 16 );
+    fmp4_put_be32( c, p_fmp4->height << 16 );
+    fmp4_end_box( c, tkhd );
+
+    unsigned mdia = fmp4_start_box( c, "mdia" );
+
+    unsigned mdhd = fmp4_start_full_box( c, "mdhd", 0, 0 );
+    fmp4_put_be32( c, 0 );                      // creation_time
+    fmp4_put_be32( c, 0 );                      // modification_time
+    fmp4_put_be32( c, p_fmp4->i_timebase_den ); // timescale
+    fmp4_put_be32( c, 0 );                      // duration
+    fmp4_put_be16( c, 0x55c4 );                 // language: und
+    fmp4_put_be16( c, 0 );                      // pre_defined
+    fmp4_end_box( c, mdhd );
+
+    unsigned hdlr = fmp4_start_full_box( c, "hdlr", 0, 0 );
+    fmp4_put_be32( c, 0 );                      // pre_defined
+    fmp4_put_tag( c, "vide" );
+    fmp4_put_zero( c, 12 );                     // reserved
+    fmp4_append_data( c, (const uint8_t*)"VideoHandler", 13 );
+    fmp4_end_box( c, hdlr );
+
+    unsigned minf = fmp4_start_box( c, "minf" );
+
+    unsigned vmhd = fmp4_start_full_box( c, "vmhd", 0, 1 );
+    fmp4_put_zero( c, 8 );                      // graphicsmode, opcolor
+    fmp4_end_box( c, vmhd );
+
+    unsigned dinf = fmp4_start_box( c, "dinf" );
+    unsigned dref = fmp4_start_full_box( c, "dref", 0, 0 );
+    fmp4_put_be32( c, 1 );                      // entry_count
+    fmp4_end_box( c, fmp4_start_full_box( c, "url ", 0, 1 ) ); // media is in the same file
+    fmp4_end_box( c, dref );
+    fmp4_end_box( c, dinf );
+
+    unsigned stbl = fmp4_start_box( c, "stbl" );
+
+    unsigned stsd = fmp4_start_full_box( c, "stsd", 0, 0 );
+    fmp4_put_be32( c, 1 );                      // entry_count
+    unsigned avc1 = fmp4_start_box( c, "avc1" );
+    fmp4_put_zero( c, 6 );                      // reserved
+    fmp4_put_be16( c, 1 );                      // data_reference_index
+    fmp4_put_zero( c, 16 );                     // pre_defined, reserved
+    fmp4_put_be16( c, p_fmp4->width );
+    fmp4_put_be16( c, p_fmp4->height );
+    fmp4_put_be32( c, 0x00480000 );             // horizresolution: 72 dpi
+    fmp4_put_be32( c, 0x00480000 );             // vertresolution
+    fmp4_put_be32( c, 0 );                      // reserved
+    fmp4_put_be16( c, 1 );                      // frame_count
+    fmp4_put_zero( c, 32 );                     // compressorname
+    fmp4_put_be16( c, 0x0018 );                 // depth
+    fmp4_put_be16( c, 0xffff );                 // pre_defined
+    write_avcc( p_fmp4, sps, sps_size, pps, pps_size );
+    if( p_fmp4->sar_width && p_fmp4->sar_height )
+    {
+        unsigned pasp = fmp4_start_box( c, "pasp" );
+        fmp4_put_be32( c, p_fmp4->sar_width );
+        fmp4_put_be32( c, p_fmp4->sar_height );
+        fmp4_end_box( c, pasp );
+    }
+    fmp4_end_box( c, avc1 );
+    fmp4_end_box( c, stsd );
+
+    /* The samples are all in the fragments: empty tables. */
+    unsigned stts = fmp4_start_full_box( c, "stts", 0, 0 );
+    fmp4_put_be32( c, 0 );
+    fmp4_end_box( c, stts );
+    unsigned stsc = fmp4_start_full_box( c, "stsc", 0, 0 );
+    fmp4_put_be32( c, 0 );
+    fmp4_end_box( c, stsc );
+    unsigned stsz = fmp4_start_full_box( c, "stsz", 0, 0 );
+    fmp4_put_be32( c, 0 );                      // sample_size
+    fmp4_put_be32( c, 0 );                      // sample_count
+    fmp4_end_box( c, stsz );
+    unsigned stco = fmp4_start_full_box( c, "stco", 0, 0 );
+    fmp4_put_be32( c, 0 );
+    fmp4_end_box( c, stco );
+
+    fmp4_end_box( c, stbl );
+    fmp4_end_box( c, minf );
+    fmp4_end_box( c, mdia );
+    fmp4_end_box( c, trak );
+
+    unsigned mvex = fmp4_start_box( c, "mvex" );
+    unsigned trex = fmp4_start_full_box( c, "trex", 0, 0 );
+    fmp4_put_be32( c, 1 );                      // track_ID
+    fmp4_put_be32( c, 1 );                      // default_sample_description_index
+    fmp4_put_be32( c, 0 );                      // default_sample_duration
+    fmp4_put_be32( c, 0 );                      // default_sample_size
+    fmp4_put_be32( c, 0 );                      // default_sample_flags
+    fmp4_end_box( c, trex );
+    fmp4_end_box( c, mvex );
+
+    fmp4_end_box( c, moov );
+}
+
+static int write_headers( hnd_t handle, x264_nal_t *p_nal )
+{
+    fmp4_hnd_t *p_fmp4 = handle;
+    fmp4_buffer *c = &p_fmp4->box;
+
+    int sps_size = p_nal[0].i_payload - 4;
+    int pps_size = p_nal[1].i_payload - 4;
+    int sei_size = p_nal[2].i_payload;
+
+    uint8_t *sps = p_nal[0].p_payload + 4;
+    uint8_t *pps = p_nal[1].p_payload + 4;
+    uint8_t *sei = p_nal[2].p_payload;
+
+    if( !p_fmp4->width || !p_fmp4->height || !p_fmp4->i_timebase_num )
+        return -1;
+
+    unsigned ftyp = fmp4_start_box( c, "ftyp" );
+    fmp4_put_tag( c, "iso6" );                  // major_brand
+    fmp4_put_be32( c, 0 );                      // minor_version
+    fmp4_put_tag( c, "iso6" );
+    fmp4_put_tag( c, "cmfc" );
+    fmp4_end_box( c, ftyp );
+    write_moov( p_fmp4, sps, sps_size, pps, pps_size );
+
+    if( p_fmp4->pattern )
+    {
+        FILE *fp = open_segment( p_fmp4, -1 );
+        if( !fp )
+            return -1;
+        int ret = fmp4_write_data( c, fp );
+        ret |= fclose( fp );
+        CHECK( ret );
+    }
+    else
+        CHECK( fmp4_write_data( c, p_fmp4->fp ) );
+
+    /* The SEI goes at the start of the first sample. */
+    p_fmp4->sei = malloc( sei_size );
+    if( !p_fmp4->sei )
+        return -1;
+    memcpy( p_fmp4->sei, sei, sei_size );
+    p_fmp4->sei_len = sei_size;
+
+    return sei_size + sps_size + pps_size;
+}
+
+/* Close the open segment, which ends at end_dts, and list it in the playlist. */
+static int end_segment( fmp4_hnd_t *p_fmp4, int64_t end_dts )
+{
+    FILE *fp = p_fmp4->fp;
+    p_fmp4->fp = NULL;
+    CHECK( fclose( fp ) );
+
+    if( p_fmp4->playlist )
+    {
+        int i_segment = p_fmp4->i_segment - 2;
+        if( i_segment >= p_fmp4->i_segments_max )
+        {
+            int i_max = X264_MAX( 2 * p_fmp4->i_segments_max, 64 );
+            double *segment_duration = realloc( p_fmp4->segment_duration, i_max * sizeof(double) );
+            if( !segment_duration )
+                return -1;
+            p_fmp4->segment_duration = segment_duration;
+            p_fmp4->i_segments_max = i_max;
+        }
+        p_fmp4->segment_duration[i_segment] = (double)(end_dts - p_fmp4->i_segment_dts) * p_fmp4->i_timebase_num / p_fmp4->i_timebase_den;
+        CHECK( write_playlist( p_fmp4, 0 ) );
+    }
+
+    return 0;
+}
+
+/* Write the held samples as a fragment, the last of them lasting until next_dts.
+ * With a pattern, the fragment starts a segment file if none is open, and
+ * b_end_segment closes it after the fragment. */
+static int write_fragment( fmp4_hnd_t *p_fmp4, int64_t next_dts, int b_end_segment )
+{
+    fmp4_buffer *c = &p_fmp4->box;
+    int64_t timebase_num = p_fmp4->i_timebase_num;
+    fmp4_sample_t *samples = p_fmp4->samples;
+    int i_samples = p_fmp4->i_samples;
+    int b_new_segment = p_fmp4->pattern && !p_fmp4->fp;
+
+    if( b_new_segment )
+    {
+        unsigned styp = fmp4_start_box( c, "styp" );
+        fmp4_put_tag( c, "msdh" );
+        fmp4_put_be32( c, 0 );
+        fmp4_put_tag( c, "msdh" );
+        fmp4_end_box( c, styp );
+    }
+
+    unsigned moof = fmp4_start_box( c, "moof" );
+
+    unsigned mfhd = fmp4_start_full_box( c, "mfhd", 0, 0 );
+    fmp4_put_be32( c, ++p_fmp4->i_sequence );
+    fmp4_end_box( c, mfhd );
+
+    unsigned traf = fmp4_start_box( c, "traf" );
+
+    unsigned tfhd = fmp4_start_full_box( c, "tfhd", 0, 0x020000 ); // default-base-is-moof
+    fmp4_put_be32( c, 1 );                      // track_ID
+    fmp4_end_box( c, tfhd );
+
+    unsigned tfdt = fmp4_start_full_box( c, "tfdt", 1, 0 );
+    fmp4_put_be64( c, (samples[0].dts - p_fmp4->i_first_dts) * timebase_num ); // baseMediaDecodeTime
+    fmp4_end_box( c, tfdt );
+
+    /* data offset, sample duration, size, flags and composition time offset */
+    unsigned trun = fmp4_start_full_box( c, "trun", 1, 0x000f01 );
+    fmp4_put_be32( c, i_samples );
+    unsigned data_offset = c->d_cur;
+    fmp4_put_be32( c, 0 );                      // data_offset, filled in below
+    for( int i = 0; i < i_samples; i++ )
+    {
+        int64_t dts_next = i + 1 < i_samples ? samples[i+1].dts : next_dts;
+        fmp4_put_be32( c, (dts_next - samples[i].dts) * timebase_num );
+        fmp4_put_be32( c, samples[i].size );
+        fmp4_put_be32( c, samples[i].b_sync ? FMP4_SAMPLE_SYNC : FMP4_SAMPLE_NON_SYNC );
+        /* signed: the first sample is presented at time 0 */
+        fmp4_put_be32( c, (samples[i].pts - samples[i].dts - p_fmp4->i_delay) * timebase_num );
+    }
+    fmp4_end_box( c, trun );
+
+    fmp4_end_box( c, traf );
+    fmp4_end_box( c, moof );
+    fmp4_rewrite_be32( c, c->d_cur - moof + 8, data_offset );
+
+    fmp4_put_be32( c, p_fmp4->mdat.d_cur + 8 );
+    fmp4_put_tag( c, "mdat" );
+
+    if( b_new_segment )
+    {
+        if( !(p_fmp4->fp = open_segment( p_fmp4, p_fmp4->i_segment++ )) )
+            return -1;
+        p_fmp4->i_segment_dts = samples[0].dts;
+    }
+    int ret = fmp4_write_data( c, p_fmp4->fp );
+    ret |= fmp4_write_data( &p_fmp4->mdat, p_fmp4->fp );
+    /* Pass each fragment on as soon as it's complete, for live use. */
+    ret |= fflush( p_fmp4->fp );
+    CHECK( ret );
+
+    p_fmp4->i_samples = 0;
+
+    if( p_fmp4->pattern && b_end_segment )
+        CHECK( end_segment( p_fmp4, next_dts ) );
+
+    return 0;
+}
+
+static int write_frame( hnd_t handle, uint8_t *p_nalu, int i_size, x264_picture_t *p_picture )
+{
+    fmp4_hnd_t *p_fmp4 = handle;
+
+    if( p_fmp4->b_first_frame )
+    {
+        p_fmp4->i_first_dts = p_picture->i_dts;
+        p_fmp4->i_delay = p_picture->i_pts - p_picture->i_dts;
+        p_fmp4->i_next_cut = p_picture->i_pts;
+        p_fmp4->b_first_frame = 0;
+    }
+
+    if( p_picture->b_keyframe && p_picture->i_pts >= p_fmp4->i_next_cut )
+    {
+        if( p_fmp4->i_samples )
+            CHECK( write_fragment( p_fmp4, p_picture->i_dts, 1 ) );
+        if( p_fmp4->i_fragment_duration )
+            while( p_fmp4->i_next_cut <= p_picture->i_pts )
+                p_fmp4->i_next_cut += p_fmp4->i_fragment_duration;
+    }
+    else if( p_fmp4->i_samples && (p_fmp4->mdat.d_cur >= FMP4_CHUNK_SIZE ||
+             p_picture->i_dts - p_fmp4->samples[0].dts >= p_fmp4->i_chunk_duration) )
+        CHECK( write_fragment( p_fmp4, p_picture->i_dts, 0 ) );
+
+    if( p_fmp4->i_samples == p_fmp4->i_samples_max )
+    {
+        int i_max = X264_MAX( 2 * p_fmp4->i_samples_max, 64 );
+        fmp4_sample_t *samples = realloc( p_fmp4->samples, i_max * sizeof(fmp4_sample_t) );
+        if( !samples )
+            return -1;
+        p_fmp4->samples = samples;
+        p_fmp4->i_samples_max = i_max;
+    }
+
+    fmp4_sample_t *sample = &p_fmp4->samples[p_fmp4->i_samples++];
+    sample->dts = p_picture->i_dts;
+    sample->pts = p_picture->i_pts;
+    sample->size = p_fmp4->sei_len + i_size;
+    /* An open-GOP I-frame isn't a sync sample: the B-frames that follow it in
+     * decoding order may reference the frames before it. Recovery points of
+     * intra refresh, which aren't I-frames, are the only random access points
+     * it has after the first frame. */
+    sample->b_sync = p_picture->i_type == X264_TYPE_IDR || (p_picture->b_keyframe && !IS_X264_TYPE_I( p_picture->i_type ));
+
+    if( p_fmp4->sei_len )
+    {
+        CHECK( fmp4_append_data( &p_fmp4->mdat, p_fmp4->sei, p_fmp4->sei_len ) );
+        free( p_fmp4->sei );
+        p_fmp4->sei = NULL;
+        p_fmp4->sei_len = 0;
+    }
+    CHECK( fmp4_append_data( &p_fmp4->mdat, p_nalu, i_size ) );
+
+    return i_size;
+}
+
+static int close_file( hnd_t handle, int64_t largest_pts, int64_t second_largest_pts )
+{
+    fmp4_hnd_t *p_fmp4 = handle;
+    int ret = 0;
+
+    if( !p_fmp4 )
+        return 0;
+
+    if( p_fmp4->i_samples )
+    {
+        int64_t i_last_delta = largest_pts - second_largest_pts;
+        if( i_last_delta <= 0 )
+            i_last_delta = p_fmp4->i_frame_duration;
+        ret = write_fragment( p_fmp4, p_fmp4->samples[p_fmp4->i_samples-1].dts + i_last_delta, 1 );
+    }
+    if( p_fmp4->playlist && !ret )
+        ret = write_playlist( p_fmp4, 1 );
+
+    if( p_fmp4->fp && p_fmp4->fp != stdout )
+        ret |= fclose( p_fmp4->fp );
+
+    free( p_fmp4->pattern );
+    free( p_fmp4->playlist );
+    free( p_fmp4->segment_duration );
+    free( p_fmp4->box.data );
+    free( p_fmp4->mdat.data );
+    free( p_fmp4->samples );
+    free( p_fmp4->sei );
+    free( p_fmp4 );
+
+    return ret;
+}
+
+const cli_output_t fmp4_output = { open_file, set_param, write_headers, write_frame, close_file };
@@ -0,0 +1,143 @@
+/*****************************************************************************
+ * fmp4_bytestream.c: fragmented mp4 muxer utilities
+ *****************************************************************************
+ * Copyright (C) 2025 x264 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at licensing@x264.com.
+ *****************************************************************************/
+
+#include "output.h"
+#include "fmp4_bytestream.h"
+
+int fmp4_append_data( fmp4_buffer *c, const uint8_t *data, unsigned size )
+{
+    unsigned ns = c->d_cur + size;
+
+    if( ns > c->d_max )
+    {
+        void *dp;
+        unsigned dn = 16;
+        while( ns > dn )
+            dn <<= 1;
+
+        dp = realloc( c->data, dn );
+        if( !dp )
+        {
+            c->b_error = 1;
+            return -1;
+        }
+
+        c->data = dp;
+        c->d_max = dn;
+    }
+
+    memcpy( c->data + c->d_cur, data, size );
+
+    c->d_cur = ns;
+
+    return 0;
+}
+
+/* Write out and empty the buffer. */
+int fmp4_write_data( fmp4_buffer *c, FILE *fp )
+{
+    if( c->b_error )
+        return -1;
+
+    if( c->d_cur && fwrite( c->data, c->d_cur, 1, fp ) != 1 )
+        return -1;
+
+    c->d_cur = 0;
+
+    return 0;
+}
+
+/* Put functions */
+
+void fmp4_put_byte( fmp4_buffer *c, uint8_t b )
+{
+    fmp4_append_data( c, &b, 1 );
+}
+
+void fmp4_put_be16( fmp4_buffer *c, uint16_t val )
+{
+    fmp4_put_byte( c, val >> 8 );
+    fmp4_put_byte( c, val );
+}
+
+void fmp4_put_be24( fmp4_buffer *c, uint32_t val )
+{
+    fmp4_put_be16( c, val >> 8 );
+    fmp4_put_byte( c, val );
+}
+
+void fmp4_put_be32( fmp4_buffer *c, uint32_t val )
+{
+    fmp4_put_be16( c, val >> 16 );
+    fmp4_put_be16( c, val );
+}
+
+void fmp4_put_be64( fmp4_buffer *c, uint64_t val )
+{
+    fmp4_put_be32( c, val >> 32 );
+    fmp4_put_be32( c, val );
+}
+
+void fmp4_put_tag( fmp4_buffer *c, const char *tag )
+{
+    fmp4_append_data( c, (const uint8_t*)tag, 4 );
+}
+
+void fmp4_put_zero( fmp4_buffer *c, unsigned size )
+{
+    while( size-- )
+        fmp4_put_byte( c, 0 );
+}
+
+void fmp4_rewrite_be32( fmp4_buffer *c, uint32_t val, unsigned pos )
+{
+    if( pos + 4 > c->d_cur )
+        return;
+    c->data[pos+0] = val >> 24;
+    c->data[pos+1] = val >> 16;
+    c->data[pos+2] = val >> 8;
+    c->data[pos+3] = val;
+}
+
+/* Box functions */
+
+unsigned fmp4_start_box( fmp4_buffer *c, const char *type )
+{
+    unsigned start = c->d_cur;
+    fmp4_put_be32( c, 0 ); // size, filled in by fmp4_end_box
+    fmp4_put_tag( c, type );
+    return start;
+}
+
+unsigned fmp4_start_full_box( fmp4_buffer *c, const char *type, uint8_t version, uint32_t flags )
+{
+    unsigned start = fmp4_start_box( c, type );
+    fmp4_put_byte( c, version );
+    fmp4_put_be24( c, flags );
+    return start;
+}
+
+void fmp4_end_box( fmp4_buffer *c, unsigned start )
+{
+    fmp4_rewrite_be32( c, c->d_cur - start, start );
+}
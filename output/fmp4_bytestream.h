@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * fmp4_bytestream.h: fragmented mp4 muxer utilities
+ *****************************************************************************
+ * Copyright (C) 2025 x264 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at licensing@x264.com.
+ *****************************************************************************/
+
+#ifndef X264_FMP4_BYTESTREAM_H
+#define X264_FMP4_BYTESTREAM_H
+
+/* sample flags of track fragment runs */
+#define FMP4_SAMPLE_SYNC     0x02000000 /* depends on no other sample */
+#define FMP4_SAMPLE_NON_SYNC 0x01010000 /* depends on others, is not a sync sample */
+
+/* Growing buffer that boxes are built in. A failed allocation is latched in
+ * b_error, so that a whole box can be put before checking. */
+typedef struct fmp4_buffer
+{
+    uint8_t *data;
+    unsigned d_cur;
+    unsigned d_max;
+    int b_error;
+} fmp4_buffer;
+
+int fmp4_append_data( fmp4_buffer *c, const uint8_t *data, unsigned size );
+int fmp4_write_data( fmp4_buffer *c, FILE *fp );
+
+void fmp4_put_byte( fmp4_buffer *c, uint8_t b );
+void fmp4_put_be16( fmp4_buffer *c, uint16_t val );
+void fmp4_put_be24( fmp4_buffer *c, uint32_t val );
+void fmp4_put_be32( fmp4_buffer *c, uint32_t val );
+void fmp4_put_be64( fmp4_buffer *c, uint64_t val );
+void fmp4_put_tag( fmp4_buffer *c, const char *tag );
+void fmp4_put_zero( fmp4_buffer *c, unsigned size );
+void fmp4_rewrite_be32( fmp4_buffer *c, uint32_t val, unsigned pos );
+
+/* Boxes are opened with their type, and closed with the position the open
+ * returned once their contents are put, which fills in their size. */
+unsigned fmp4_start_box( fmp4_buffer *c, const char *type );
+unsigned fmp4_start_full_box( fmp4_buffer *c, const char *type, uint8_t version, uint32_t flags );
+void fmp4_end_box( fmp4_buffer *c, unsigned start );
+
+#endif
@@ -311,6 +311,7 @@ mk_writer *mk_create_writer( const char *filename )
         free( w );
         return NULL;
     }
+    setvbuf( w->fp, NULL, _IOFBF, OUTPUT_BUFFER_SIZE );
 
     w->timescale = 1000000;
 
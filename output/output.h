@@ -29,23 +29,62 @@
 
 #include "x264cli.h"
 
+/* stdio buffer for the muxers' files, so that they write in large blocks */
+#define OUTPUT_BUFFER_SIZE (1<<20)
+
+typedef struct cli_output_t cli_output_t;
+
+/* Fragments are cut at the first keyframe at or past each multiple of the
+ * fragment duration from the first frame; the encoder forces a keyframe at the
+ * first frame past each of them, so that the cuts fall exactly on the grid. */
+static inline int64_t x264_cli_fragment_ticks( double duration, x264_param_t *param )
+{
+    if( duration <= 0 )
+        return 0;
+    return X264_MAX( (int64_t)(duration * param->i_timebase_den / param->i_timebase_num + 0.5), 1 );
+}
+
+/* an output of the tee, and whether it takes an Annex B bytestream */
+typedef struct
+{
+    const cli_output_t *output;
+    hnd_t handle;
+    int b_annexb;
+} cli_tee_branch_t;
+
 typedef struct
 {
     int use_dts_compress;
+    /* fmp4: seconds between fragment cuts, 0 to cut at each keyframe */
+    double fragment_duration;
+    /* fmp4: write an HLS playlist of the segment files, listing the last hls_list_size (0: all) */
+    int hls;
+    int hls_list_size;
+    /* tee: the opened outputs it writes to, the first one being the main output */
+    cli_tee_branch_t *tee;
+    int tee_count;
+    /* threaded output: the output it runs in its thread and the frames it can queue
+     * (< 0 if not given), and the total time spent waiting for the queue to take a frame */
+    const cli_output_t *writer_output;
+    int queue_size;
+    int64_t *stall_time;
 } cli_output_opt_t;
 
-typedef struct
+struct cli_output_t
 {
     int (*open_file)( char *psz_filename, hnd_t *p_handle, cli_output_opt_t *opt );
     int (*set_param)( hnd_t handle, x264_param_t *p_param );
     int (*write_headers)( hnd_t handle, x264_nal_t *p_nal );
     int (*write_frame)( hnd_t handle, uint8_t *p_nal, int i_size, x264_picture_t *p_picture );
     int (*close_file)( hnd_t handle, int64_t largest_pts, int64_t second_largest_pts );
-} cli_output_t;
+};
 
 extern const cli_output_t raw_output;
 extern const cli_output_t mkv_output;
 extern const cli_output_t mp4_output;
 extern const cli_output_t flv_output;
+extern const cli_output_t fmp4_output;
+extern const cli_output_t tee_output;
+extern const cli_output_t thread_output;
 
 #endif
@@ -30,7 +30,9 @@ static int open_file( char *psz_filename, hnd_t *p_handle, cli_output_opt_t *opt
 {
     if( !strcmp( psz_filename, "-" ) )
         *p_handle = stdout;
-    else if( !(*p_handle = x264_fopen( psz_filename, "w+b" )) )
+    else if( (*p_handle = x264_fopen( psz_filename, "w+b" )) )
+        setvbuf( (FILE*)*p_handle, NULL, _IOFBF, OUTPUT_BUFFER_SIZE );
+    else
         return -1;
 
     return 0;
@@ -0,0 +1,165 @@
+/*****************************************************************************
+ * tee.c: tee output
+ *****************************************************************************
+ * Copyright (C) 2025 x264 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at licensing@x264.com.
+ *****************************************************************************/
+
+#include "output.h"
+
+/* Passes every call on to several opened outputs, which are typically each
+ * run in a thread of their own. The encoder writes a single stream for all of
+ * them, length-prefixed if any of them needs it; outputs that take an Annex B
+ * bytestream then get a copy with the prefixes turned into start codes, which
+ * are the same size. The sizes returned are those of the first output. */
+typedef struct
+{
+    cli_output_t output;
+    hnd_t handle;
+    int b_annexb;
+} tee_branch_t;
+
+typedef struct
+{
+    tee_branch_t *branch;
+    int count;
+    int b_convert;      /* the stream is length-prefixed, convert it for Annex B outputs */
+    uint8_t *buf;
+    int buf_size;
+} tee_hnd_t;
+
+static int open_file( char *psz_filename, hnd_t *p_handle, cli_output_opt_t *opt )
+{
+    tee_hnd_t *h = calloc( 1, sizeof(tee_hnd_t) );
+    if( !h )
+        return -1;
+    h->branch = calloc( opt->tee_count, sizeof(tee_branch_t) );
+    if( !h->branch )
+    {
+        free( h );
+        return -1;
+    }
+    h->count = opt->tee_count;
+    for( int i = 0; i < h->count; i++ )
+    {
+        h->branch[i].output = *opt->tee[i].output;
+        h->branch[i].handle = opt->tee[i].handle;
+        h->branch[i].b_annexb = opt->tee[i].b_annexb;
+    }
+    *p_handle = h;
+    return 0;
+}
+
+/* Copy a length-prefixed stream to the conversion buffer, with start codes. */
+static uint8_t *convert( tee_hnd_t *h, uint8_t *data, int size )
+{
+    if( size > h->buf_size )
+    {
+        free( h->buf );
+        h->buf_size = size + (size >> 2);
+        h->buf = malloc( h->buf_size );
+        if( !h->buf )
+        {
+            h->buf_size = 0;
+            return NULL;
+        }
+    }
+    memcpy( h->buf, data, size );
+    for( int pos = 0; pos + 4 <= size; )
+    {
+        uint8_t *p = h->buf + pos;
+        pos += 4 + ((p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+        p[0] = p[1] = p[2] = 0;
+        p[3] = 1;
+    }
+    return h->buf;
+}
+
+static int set_param( hnd_t handle, x264_param_t *p_param )
+{
+    tee_hnd_t *h = handle;
+    int ret = 0;
+    h->b_convert = !p_param->b_annexb;
+    for( int i = 0; i < h->count; i++ )
+        ret |= h->branch[i].output.set_param( h->branch[i].handle, p_param );
+    return ret;
+}
+
+static int write_headers( hnd_t handle, x264_nal_t *p_nal )
+{
+    tee_hnd_t *h = handle;
+    int ret = 0;
+    for( int i = 0; i < h->count; i++ )
+    {
+        x264_nal_t nal[3];
+        x264_nal_t *p = p_nal;
+        if( h->b_convert && h->branch[i].b_annexb )
+        {
+            /* The headers are contiguous; raw output writes them in one go. */
+            int size = p_nal[0].i_payload + p_nal[1].i_payload + p_nal[2].i_payload;
+            uint8_t *data = convert( h, p_nal[0].p_payload, size );
+            if( !data )
+                return -1;
+            for( int j = 0; j < 3; j++ )
+            {
+                nal[j] = p_nal[j];
+                nal[j].p_payload = data + (p_nal[j].p_payload - p_nal[0].p_payload);
+            }
+            p = nal;
+        }
+        int size = h->branch[i].output.write_headers( h->branch[i].handle, p );
+        if( size < 0 )
+            return -1;
+        if( !i )
+            ret = size;
+    }
+    return ret;
+}
+
+static int write_frame( hnd_t handle, uint8_t *p_nalu, int i_size, x264_picture_t *p_picture )
+{
+    tee_hnd_t *h = handle;
+    int ret = 0;
+    for( int i = 0; i < h->count; i++ )
+    {
+        uint8_t *data = p_nalu;
+        if( h->b_convert && h->branch[i].b_annexb && !(data = convert( h, p_nalu, i_size )) )
+            return -1;
+        int size = h->branch[i].output.write_frame( h->branch[i].handle, data, i_size, p_picture );
+        if( size < 0 )
+            return -1;
+        if( !i )
+            ret = size;
+    }
+    return ret;
+}
+
+static int close_file( hnd_t handle, int64_t largest_pts, int64_t second_largest_pts )
+{
+    tee_hnd_t *h = handle;
+    int ret = 0;
+    for( int i = 0; i < h->count; i++ )
+        ret |= h->branch[i].output.close_file( h->branch[i].handle, largest_pts, second_largest_pts );
+    free( h->buf );
+    free( h->branch );
+    free( h );
+    return ret;
+}
+
+const cli_output_t tee_output = { open_file, set_param, write_headers, write_frame, close_file };
@@ -0,0 +1,201 @@
+/*****************************************************************************
+ * thread.c: threaded output
+ *****************************************************************************
+ * Copyright (C) 2003-2025 x264 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at licensing@x264.com.
+ *****************************************************************************/
+
+#include "output.h"
+#include "common/threadpool.h"
+
+/* A writer thread passes frames to the muxer in order from a queue of up to
+ * queue_size copies, so that a slow write doesn't hold up the encoder until
+ * the queue is full. Headers and parameters are passed on directly, once the
+ * queue is empty, and a failed write is reported by the next call. */
+typedef struct
+{
+    uint8_t *data;
+    int size;
+    int capacity;
+    x264_picture_t pic;
+} thread_frame_t;
+
+typedef struct
+{
+    cli_output_t output;
+    hnd_t handle;
+    x264_threadpool_t *pool;
+
+    x264_pthread_mutex_t mutex;
+    x264_pthread_cond_t cv_fill;   /* signaled when a frame is queued or the writer should stop */
+    x264_pthread_cond_t cv_space;  /* signaled when a frame has been written */
+    thread_frame_t *frame;
+    int queue_size;
+    int head;           /* slot of the oldest queued frame */
+    int count;          /* number of queued frames */
+    int b_stop;
+    int b_error;        /* a write failed */
+
+    /* stats */
+    int frames;
+    int stalled;        /* frames that had to wait for a free slot */
+    int64_t stall_time;
+    int64_t *total_stall_time;  /* of all the queues, shown in the progress line */
+} thread_hnd_t;
+
+static void *write_frames_thread( thread_hnd_t *h )
+{
+    x264_pthread_mutex_lock( &h->mutex );
+    for( ;; )
+    {
+        while( !h->count && !h->b_stop )
+            x264_pthread_cond_wait( &h->cv_fill, &h->mutex );
+        if( !h->count )
+            break;
+        /* The encoder only touches slots past the queued ones. */
+        thread_frame_t *f = &h->frame[h->head];
+        x264_pthread_mutex_unlock( &h->mutex );
+
+        int ret = h->output.write_frame( h->handle, f->data, f->size, &f->pic );
+
+        x264_pthread_mutex_lock( &h->mutex );
+        h->b_error |= ret < 0;
+        h->head = (h->head + 1) % h->queue_size;
+        h->count--;
+        x264_pthread_cond_broadcast( &h->cv_space );
+    }
+    x264_pthread_mutex_unlock( &h->mutex );
+    return NULL;
+}
+
+static int open_file( char *psz_filename, hnd_t *p_handle, cli_output_opt_t *opt )
+{
+    thread_hnd_t *h = calloc( 1, sizeof(thread_hnd_t) );
+    FAIL_IF_ERR( !h, "x264", "malloc failed\n" );
+    h->output = *opt->writer_output;
+    h->handle = *p_handle;
+    h->queue_size = X264_MAX( opt->queue_size, 1 );
+    h->total_stall_time = opt->stall_time;
+    h->frame = calloc( h->queue_size, sizeof(thread_frame_t) );
+    FAIL_IF_ERR( !h->frame, "x264", "malloc failed\n" );
+
+    if( x264_pthread_mutex_init( &h->mutex, NULL ) ||
+        x264_pthread_cond_init( &h->cv_fill, NULL ) ||
+        x264_pthread_cond_init( &h->cv_space, NULL ) ||
+        x264_threadpool_init( &h->pool, 1 ) )
+        return -1;
+    x264_threadpool_run( h->pool, (void*)write_frames_thread, h );
+
+    *p_handle = h;
+    return 0;
+}
+
+/* Wait for the writer to empty the queue. Returns nonzero if a write failed. */
+static int drain( thread_hnd_t *h )
+{
+    x264_pthread_mutex_lock( &h->mutex );
+    while( h->count )
+        x264_pthread_cond_wait( &h->cv_space, &h->mutex );
+    int b_error = h->b_error;
+    x264_pthread_mutex_unlock( &h->mutex );
+    return b_error;
+}
+
+static int set_param( hnd_t handle, x264_param_t *p_param )
+{
+    thread_hnd_t *h = handle;
+    if( drain( h ) )
+        return -1;
+    return h->output.set_param( h->handle, p_param );
+}
+
+static int write_headers( hnd_t handle, x264_nal_t *p_nal )
+{
+    thread_hnd_t *h = handle;
+    if( drain( h ) )
+        return -1;
+    return h->output.write_headers( h->handle, p_nal );
+}
+
+static int write_frame( hnd_t handle, uint8_t *p_nalu, int i_size, x264_picture_t *p_picture )
+{
+    thread_hnd_t *h = handle;
+
+    x264_pthread_mutex_lock( &h->mutex );
+    if( h->count == h->queue_size && !h->b_error )
+    {
+        int64_t start = x264_mdate();
+        while( h->count == h->queue_size && !h->b_error )
+            x264_pthread_cond_wait( &h->cv_space, &h->mutex );
+        int64_t stall = x264_mdate() - start;
+        h->stall_time += stall;
+        h->stalled++;
+        if( h->total_stall_time )
+            *h->total_stall_time += stall;
+    }
+    int b_error = h->b_error;
+    thread_frame_t *f = &h->frame[(h->head + h->count) % h->queue_size];
+    x264_pthread_mutex_unlock( &h->mutex );
+    if( b_error )
+        return -1;
+
+    if( i_size > f->capacity )
+    {
+        free( f->data );
+        f->capacity = i_size + (i_size >> 2);
+        f->data = malloc( f->capacity );
+        FAIL_IF_ERR( !f->data, "x264", "malloc failed\n" );
+    }
+    memcpy( f->data, p_nalu, i_size );
+    f->size = i_size;
+    f->pic = *p_picture;
+
+    x264_pthread_mutex_lock( &h->mutex );
+    h->count++;
+    h->frames++;
+    x264_pthread_cond_broadcast( &h->cv_fill );
+    x264_pthread_mutex_unlock( &h->mutex );
+    return i_size;
+}
+
+static int close_file( hnd_t handle, int64_t largest_pts, int64_t second_largest_pts )
+{
+    thread_hnd_t *h = handle;
+    x264_pthread_mutex_lock( &h->mutex );
+    h->b_stop = 1;
+    x264_pthread_cond_broadcast( &h->cv_fill );
+    x264_pthread_mutex_unlock( &h->mutex );
+    x264_threadpool_wait( h->pool, h );
+    if( h->frames )
+        x264_cli_log( "thread", X264_LOG_INFO, "output queue of %d: stalled on %d of %d frames, %.2fs total\n",
+                      h->queue_size, h->stalled, h->frames, h->stall_time / 1e6 );
+    int ret = h->b_error ? -1 : 0;
+    ret |= h->output.close_file( h->handle, largest_pts, second_largest_pts );
+    x264_threadpool_delete( h->pool );
+    x264_pthread_cond_destroy( &h->cv_space );
+    x264_pthread_cond_destroy( &h->cv_fill );
+    x264_pthread_mutex_destroy( &h->mutex );
+    for( int i = 0; i < h->queue_size; i++ )
+        free( h->frame[i].data );
+    free( h->frame );
+    free( h );
+    return ret;
+}
+
+const cli_output_t thread_output = { open_file, set_param, write_headers, write_frame, close_file };
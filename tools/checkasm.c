@@ -28,6 +28,7 @@
 #include <ctype.h>
 #include "common/common.h"
 #include "encoder/macroblock.h"
+#include "filters/video/scale.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -2866,6 +2867,271 @@ static int check_bitstream( uint32_t cpu_ref, uint32_t cpu_new )
     return ret;
 }
 
+/* VIF of one window straight from its definition: two-pass moments in double,
+ * in units of 8-bit pixels, with the same guards against flat windows. */
+static void vif_ref_window( pixel *pix1, intptr_t stride1, pixel *pix2, intptr_t stride2, int size, double vif[2] )
+{
+    double scale = 1.0 / (1 << (BIT_DEPTH-8));
+    double n = size * size, mu1 = 0, mu2 = 0, sigma1_sq = 0, sigma2_sq = 0, sigma12 = 0;
+    for( int y = 0; y < size; y++ )
+        for( int x = 0; x < size; x++ )
+        {
+            mu1 += pix1[y*stride1+x] * scale / n;
+            mu2 += pix2[y*stride2+x] * scale / n;
+        }
+    for( int y = 0; y < size; y++ )
+        for( int x = 0; x < size; x++ )
+        {
+            double d1 = pix1[y*stride1+x] * scale - mu1;
+            double d2 = pix2[y*stride2+x] * scale - mu2;
+            sigma1_sq += d1 * d1 / n;
+            sigma2_sq += d2 * d2 / n;
+            sigma12   += d1 * d2 / n;
+        }
+    double g = sigma12 / (sigma1_sq + 1e-10);
+    double sv_sq = sigma2_sq - g * sigma12;
+    if( sigma1_sq < 1e-10 )
+    {
+        g = 0;
+        sv_sq = sigma2_sq;
+        sigma1_sq = 0;
+    }
+    if( sigma2_sq < 1e-10 )
+        g = sv_sq = 0;
+    if( g < 0 )
+    {
+        sv_sq = sigma2_sq;
+        g = 0;
+    }
+    sv_sq = X264_MAX( sv_sq, 1e-10 );
+    vif[0] += log10( 1.0 + g * g * sigma1_sq / (sv_sq + 2.0) );
+    vif[1] += log10( 1.0 + sigma1_sq / 2.0 );
+}
+
+static void vif_ref( pixel *pix1, intptr_t stride1, pixel *pix2, intptr_t stride2, int width, int height, double vif[2] )
+{
+    for( int y = 0; y+8 <= height; y += 8 )
+        for( int x = 0; x+8 <= width; x += 8 )
+            vif_ref_window( pix1+y*stride1+x, stride1, pix2+y*stride2+x, stride2, 8, vif );
+    for( int y = 0; y+16 <= height; y += 16 )
+        for( int x = 0; x+16 <= width; x += 16 )
+            vif_ref_window( pix1+y*stride1+x, stride1, pix2+y*stride2+x, stride2, 16, vif );
+}
+
+/* Both passes of the scale filter straight from the kernels, with 64-bit sums. */
+static void scale_ref( int *dst, int *src, scale_plane_t *p, int high )
+{
+    static int64_t tmp[40][64*3];
+    int comps = p->comps;
+    int hshift = HSHIFT(high), vshift = 2*COEF_BITS - hshift;
+    for( int y = 0; y < p->src_height; y++ )
+        for( int x = 0; x < p->dst_width; x++ )
+            for( int c = 0; c < comps; c++ )
+            {
+                int64_t sum = 0;
+                for( int t = 0; t < p->h.taps; t++ )
+                    sum += p->h.coef[x*p->h.taps+t] * (int64_t)src[(y*p->src_width + p->h.pos[x] + t)*comps + c];
+                tmp[y][x*comps+c] = (sum + ((1 << hshift) >> 1)) >> hshift;
+            }
+    for( int y = 0; y < p->dst_height; y++ )
+        for( int x = 0; x < p->dst_width*comps; x++ )
+        {
+            int64_t sum = 1 << (vshift - 1);
+            for( int t = 0; t < p->v.taps; t++ )
+                sum += p->v.coef[y*p->v.taps+t] * tmp[p->v.pos[y]+t][x];
+            dst[y*p->dst_width*comps+x] = x264_clip3( sum >> vshift, 0, high ? 65535 : 255 );
+        }
+}
+
+/* The C kernels that have no asm to be compared with are checked against their
+ * definitions here, whatever the cpu. */
+static int check_c_kernels( void )
+{
+    int ret = 0, ok = 1, used_asm = 1;
+
+    /* 44x28 has partial 16x16 tiles and partial 8x8 windows on both edges. */
+    ALIGNED_16( pixel src[28*48] );
+    ALIGNED_16( pixel dst[28*48] );
+    x264_emms();
+    for( int i = 0; i < 64 && ok; i++ )
+    {
+        double res_c[2] = {0}, res_ref[2] = {0};
+        int noise = i&31;
+        for( int k = 0; k < 28*48; k++ )
+        {
+            /* Smooth gradients with texture, so that most windows have detail to lose */
+            src[k] = x264_clip_pixel( ((k%48)*3 + (k/48)*5 + (rand()&63)) << (BIT_DEPTH-8) );
+            dst[k] = i&32 ? x264_clip_pixel( src[k] + ((rand()%(2*noise+1) - noise) << (BIT_DEPTH-8)) )
+                          : x264_clip_pixel( ((k%48)*3 + (k/48)*5) << (BIT_DEPTH-8) );
+        }
+        x264_pixel_vif_wxh( src, 48, dst, 48, 44, 28, res_c );
+        vif_ref( src, 48, dst, 48, 44, 28, res_ref );
+        if( fabs( res_c[0] - res_ref[0] ) > 1e-6 * (1 + res_ref[0]) ||
+            fabs( res_c[1] - res_ref[1] ) > 1e-6 * (1 + res_ref[1]) )
+        {
+            ok = 0;
+            fprintf( stderr, "vif: %.9f/%.9f != %.9f/%.9f [FAILED]\n", res_c[0], res_c[1], res_ref[0], res_ref[1] );
+        }
+    }
+    /* Known values: an exact copy keeps all the information, a flat one none of it. */
+    double vif_same[2] = {0}, vif_flat[2] = {0};
+    for( int k = 0; k < 28*48; k++ )
+        dst[k] = PIXEL_MAX/2;
+    x264_pixel_vif_wxh( src, 48, src, 48, 44, 28, vif_same );
+    x264_pixel_vif_wxh( src, 48, dst, 48, 44, 28, vif_flat );
+    if( vif_same[1] <= 0 || fabs( vif_same[0] / vif_same[1] - 1.0 ) > 1e-6 || vif_flat[0] != 0 || vif_flat[1] <= 0 )
+    {
+        ok = 0;
+        fprintf( stderr, "vif: same %.9f, flat %.9f [FAILED]\n", vif_same[0] / vif_same[1], vif_flat[0] / vif_flat[1] );
+    }
+    report( "vif :" );
+
+    /* With --fast-rd-rate, residuals are costed with the context states frozen at the start
+     * of the mb. As long as no context is coded twice within the block, that is exactly
+     * what the adaptive RD estimate gives. */
+    static const int8_t fast_rd_blocks[][16] =
+    {
+        { 1 },
+        { [3] = 1, [7] = -1, [12] = 1 },
+        { 1, -1, 1, 1 },
+        { [2] = 5 },
+        { [6] = -14 },
+        { [14] = 15 },
+        { [9] = -40 },
+        { [1] = 1, [5] = 2 },
+        { -3, [4] = 1, [10] = 1 },
+        { [15] = -1 },
+        { [2] = 1, [15] = 9 },
+    };
+    x264_t h;
+    h.sps->i_chroma_format_idc = CHROMA_420;
+    h.mb.b_interlaced = 0;
+    x264_bitstream_init( 0, &h.bsf );
+    x264_quant_init( &h, 0, &h.quantf );
+    x264_rdo_init();
+    ok = 1;
+    for( int slice_type = SLICE_TYPE_P; slice_type <= SLICE_TYPE_I; slice_type++ )
+        for( int qp = 12; qp <= 40; qp += 14 )
+        {
+            x264_cabac_context_init( &h, &h.cabac, slice_type, qp, 0 );
+            for( int cat = DCT_LUMA_AC; cat <= DCT_LUMA_4x4; cat++ )
+            {
+                x264_cabac_rd_table_init( &h, cat );
+                for( int i = 0; i < sizeof(fast_rd_blocks)/sizeof(*fast_rd_blocks); i++ )
+                {
+                    ALIGNED_ARRAY_16( dctcoef, dct, [16] );
+                    int count = cat == DCT_LUMA_AC ? 15 : 16;
+                    int nz = 0;
+                    for( int k = 0; k < 16; k++ )
+                        nz |= dct[k] = k < count ? fast_rd_blocks[i][k] : 0;
+                    if( !nz )
+                        continue;
+                    x264_cabac_t cb = h.cabac;
+                    cb.f8_bits_encoded = 0;
+                    x264_cabac_block_residual_rd_c( &h, &cb, cat, dct );
+                    int last = h.quantf.coeff_last[cat]( dct );
+                    int fast = h.bsf.cabac_block_residual_bits( dct, last, &h.mb.cabac_rd[cat] );
+                    if( fast != cb.f8_bits_encoded )
+                    {
+                        ok = 0;
+                        fprintf( stderr, "fast rd rate: block %d, cat %d, slice %d, qp %d: %d != %d [FAILED]\n",
+                                 i, cat, slice_type, qp, fast, cb.f8_bits_encoded );
+                    }
+                }
+            }
+        }
+    report( "fast rd rate :" );
+
+    /* The scale filter's kernels: each filter sums to exactly 1.0 within the input,
+     * and the two passes match the reference for random sizes and extreme inputs. */
+    ok = 1;
+    for( int i = 0; i < 256 && ok; i++ )
+    {
+        static int in[40*48*3], out[40*64*3];
+        static uint8_t src8[40*48*3], dst8[40*64*3];
+        static uint16_t src16[40*48*3], dst16[40*64*3];
+        static int32_t tmp[40*64*3];
+        const scale_method_t *method = &x264_scale_methods[i&3];
+        int high = (i>>2)&1;
+        int pixel_max = high ? 65535 : 255;
+        scale_plane_t p = { .comps = 1 + rand()%3 };
+        p.src_width  = 1 + rand()%48;
+        p.src_height = 1 + rand()%40;
+        /* Every 8th plane is a copy, which has to be exact. */
+        p.dst_width  = i&56 ? 1 + rand()%64 : p.src_width;
+        p.dst_height = i&56 ? 1 + rand()%40 : p.src_height;
+        p.tmp = tmp;
+        if( x264_scale_init_kernel( &p.h, method, p.src_width, p.dst_width, i&16 ? 0.25 : 0.5 ) ||
+            x264_scale_init_kernel( &p.v, method, p.src_height, p.dst_height, 0.5 ) )
+        {
+            ok = 0;
+            fprintf( stderr, "scale: init_kernel failed [FAILED]\n" );
+            break;
+        }
+        for( int pass = 0; pass < 2; pass++ )
+        {
+            scale_kernel_t *k = pass ? &p.v : &p.h;
+            int src_len = pass ? p.src_height : p.src_width;
+            int dst_len = pass ? p.dst_height : p.dst_width;
+            for( int x = 0; x < dst_len; x++ )
+            {
+                int sum = 0;
+                for( int t = 0; t < k->taps; t++ )
+                    sum += k->coef[x*k->taps+t];
+                if( sum != 1 << COEF_BITS || k->pos[x] < 0 || k->pos[x] + k->taps > src_len ||
+                    (src_len == dst_len && (k->taps != 1 || k->pos[x] != x)) )
+                {
+                    ok = 0;
+                    fprintf( stderr, "scale: %s %d->%d, filter %d: sum %d, pos %d, taps %d [FAILED]\n",
+                             method->name, src_len, dst_len, x, sum, k->pos[x], k->taps );
+                    break;
+                }
+            }
+        }
+        /* Random pixels, then full-scale edges for the most ringing. */
+        int count = p.src_width * p.src_height * p.comps;
+        for( int k = 0; k < count; k++ )
+            in[k] = i&32 ? rand() & pixel_max : (((k / p.comps) % p.src_width + k / (p.src_width * p.comps)) & 1) * pixel_max;
+        scale_ref( out, in, &p, high );
+        int y1 = rand() % (p.dst_height + 1);
+        if( high )
+        {
+            for( int k = 0; k < count; k++ )
+                src16[k] = in[k];
+            x264_scale_h_16( tmp, src16, p.src_width * p.comps, p.src_height, &p, HSHIFT(1) );
+            x264_scale_v_16( dst16, p.dst_width * p.comps, 0, y1, &p, 2*COEF_BITS - HSHIFT(1) );
+            x264_scale_v_16( dst16 + y1 * p.dst_width * p.comps, p.dst_width * p.comps, y1, p.dst_height, &p, 2*COEF_BITS - HSHIFT(1) );
+        }
+        else
+        {
+            for( int k = 0; k < count; k++ )
+                src8[k] = in[k];
+            x264_scale_h_8( tmp, src8, p.src_width * p.comps, p.src_height, &p, HSHIFT(0) );
+            x264_scale_v_8( dst8, p.dst_width * p.comps, 0, y1, &p, 2*COEF_BITS - HSHIFT(0) );
+            x264_scale_v_8( dst8 + y1 * p.dst_width * p.comps, p.dst_width * p.comps, y1, p.dst_height, &p, 2*COEF_BITS - HSHIFT(0) );
+        }
+        for( int k = 0; k < p.dst_width * p.dst_height * p.comps && ok; k++ )
+        {
+            int res = high ? dst16[k] : dst8[k];
+            int exp = p.dst_width == p.src_width && p.dst_height == p.src_height ? in[k] : out[k];
+            if( res != exp || res != out[k] )
+            {
+                ok = 0;
+                fprintf( stderr, "scale: %s %dx%d->%dx%d, %d comps, %d-bit: sample %d: %d != %d [FAILED]\n",
+                         method->name, p.src_width, p.src_height, p.dst_width, p.dst_height, p.comps,
+                         high ? 16 : 8, k, res, exp );
+            }
+        }
+        free( p.h.pos );
+        free( p.h.coef );
+        free( p.v.pos );
+        free( p.v.coef );
+    }
+    report( "scale :" );
+
+    return ret;
+}
+
 static int check_all_funcs( uint32_t cpu_ref, uint32_t cpu_new )
 {
     return check_pixel( cpu_ref, cpu_new )
@@ -2904,6 +3170,9 @@ static int check_all_flags( void )
         simd_warmup_func = x264_checkasm_warmup_avx;
 #endif
     simd_warmup();
+    if( !quiet )
+        fprintf( stderr, "x264: C\n" );
+    ret |= check_c_kernels();
 #if ARCH_AARCH64 && HAVE_SVE
     char buf[20];
 #endif
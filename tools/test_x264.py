@@ -37,6 +37,7 @@ OPTIONS = [
     ("", "--interlaced"),
     ("", "--slice-max-size 1000"),
     ("", "--frame-packing 5"),
+    ("", "--cabac-thread"),
     [ "--preset %s" % p for p in ("ultrafast",
                                   "superfast",
                                   "veryfast",
@@ -349,6 +350,42 @@ class Regression(Case):
             try: os.remove("%s.264" % self.fixture.dispatcher.video)
             except: pass
 
+class CabacThread(Case):
+    depends = [ Compile ]
+
+    # presets whose analysis doesn't read the cabac states, so that writing
+    # the bitstream in a thread of its own must not change it, and one whose
+    # analysis does, so that the option must be turned off
+    presets = ("superfast", "veryfast", "medium")
+
+    def _run_x264(self, options):
+        try:
+            x264_proc = Popen([
+                "./x264",
+                "-o",
+                "%s.264" % self.fixture.dispatcher.video
+            ] + options + [
+                self.fixture.dispatcher.video
+            ], stdout=PIPE, stderr=STDOUT)
+
+            output = x264_proc.communicate()[0]
+            if x264_proc.returncode != 0:
+                raise FailedTestError("x264 did not complete properly: %s" % output.replace("\n", " "))
+
+            # leave out the SEI, which has the options in it
+            stream = open("%s.264" % self.fixture.dispatcher.video, "rb").read()
+            return [ nal for nal in stream.split("\x00\x00\x01") if nal and (ord(nal[0]) & 0x1f) != 6 ]
+        finally:
+            try: os.remove("%s.264" % self.fixture.dispatcher.video)
+            except: pass
+
+    @comparer(compare_pass)
+    def test_bitexact(self):
+        for preset in self.presets:
+            options = [ "--preset", preset, "--threads", "4" ] + self.fixture.dispatcher.x264
+            if self._run_x264(options) != self._run_x264(options + [ "--cabac-thread" ]):
+                raise FailedTestError("--cabac-thread changed the output of --preset %s" % preset)
+
 def _generate_random_commandline():
     commandline = []
 
@@ -363,6 +400,7 @@ fixture = x264()
 fixture.register_case(Compile)
 
 fixture.register_case(Regression)
+fixture.register_case(CabacThread)
 
 class Dispatcher(_Dispatcher):
     video = "akiyo_qcif.y4m"
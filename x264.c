@@ -126,6 +126,38 @@ static void sigint_handler( int a )
     b_ctrl_c = 1;
 }
 
+#define MAX_RENDITIONS 8
+#define MAX_TEE_OUTPUTS 8
+
+/* An extra encode of the same input, fed by its own branch of the filter chain
+ * and, if threads are available, from a thread of its own. */
+typedef struct {
+    x264_param_t param;
+    char *filename;
+    cli_output_t output;
+    hnd_t hout;
+    hnd_t hin;
+    cli_vid_filter_t filter;
+    x264_t *h;
+    int64_t i_file;
+    int i_frame_output;
+    int64_t stall_time;     /* waiting for its output queue, not yet in output_stall_time */
+
+    /* the current job: encode the main encode's picture pic, or flush if b_flush */
+    x264_picture_t pic;
+    int i_frame;
+    int b_flush;
+    int ret;
+#if HAVE_THREAD
+    x264_pthread_t thread;
+    x264_pthread_mutex_t mutex;
+    x264_pthread_cond_t cv;
+    int b_thread;
+    int b_busy;
+    int b_stop;
+#endif
+} cli_rendition_t;
+
 typedef struct {
     int b_progress;
     int i_seek;
@@ -133,14 +165,21 @@ typedef struct {
     hnd_t hout;
     FILE *qpfile;
     FILE *tcfile_out;
+    FILE *mb_stats;
     double timebase_convert_multiplier;
     int i_pulldown;
+    double fragment_duration;
+    cli_rendition_t *rendition;
+    int i_renditions;
 } cli_opt_t;
 
 /* file i/o operation structs */
 cli_input_t cli_input;
 static cli_output_t cli_output;
 
+/* time the encoder has spent waiting for the output queues to take a frame */
+static int64_t output_stall_time;
+
 /* video filter operation struct */
 static cli_vid_filter_t filter;
 
@@ -150,6 +189,7 @@ const char * const x264_log_level_names[] = { "none", "error", "warning", "info"
 const char * const x264_partition_names[] = { "p8x8", "p4x4", "b8x8", "i8x8", "i4x4", "none", "all", 0 };
 const char * const x264_pulldown_names[] = { "none", "22", "32", "64", "double", "triple", "euro", 0 };
 const char * const x264_range_names[] = { "auto", "tv", "pc", 0 };
+const char * const x264_dither_names[] = { "diffusion", "ordered", 0 };
 
 const char * const x264_output_csp_names[] =
 {
@@ -204,7 +244,7 @@ const char * const x264_demuxer_names[] =
 
 const char * const x264_muxer_names[] =
 {
-    "auto", "raw", "mkv", "flv",
+    "auto", "raw", "mkv", "flv", "fmp4",
 #if HAVE_GPAC || HAVE_LSMASH
     "mp4",
 #endif
@@ -396,6 +436,16 @@ REALIGN_STACK int main( int argc, char **argv )
         ret = encode( &param, &opt );
 
     /* clean up handles */
+    for( int i = 0; i < opt.i_renditions; i++ )
+    {
+        cli_rendition_t *r = &opt.rendition[i];
+        if( r->filter.free )
+            r->filter.free( r->hin );
+        if( r->hout )
+            r->output.close_file( r->hout, 0, 0 );
+        x264_param_cleanup( &r->param );
+    }
+    free( opt.rendition );
     if( filter.free )
         filter.free( opt.hin );
     else if( opt.hin )
@@ -404,6 +454,8 @@ REALIGN_STACK int main( int argc, char **argv )
         cli_output.close_file( opt.hout, 0, 0 );
     if( opt.tcfile_out )
         fclose( opt.tcfile_out );
+    if( opt.mb_stats )
+        fclose( opt.mb_stats );
     if( opt.qpfile )
         fclose( opt.qpfile );
     x264_param_cleanup( &param );
@@ -498,6 +550,7 @@ static void help( x264_param_t *defaults, int longhelp )
         " .264 -> Raw bytestream\n"
         " .mkv -> Matroska\n"
         " .flv -> Flash Video\n"
+        " .m4s, .cmfv -> Fragmented MP4 (CMAF)\n"
         " .mp4 -> MP4 if compiled with GPAC or L-SMASH support (%s)\n"
         "Output bit depth: %s\n"
         "\n"
@@ -741,6 +794,8 @@ static void help( x264_param_t *defaults, int longhelp )
     H2( "      --vbv-init <float>      Initial VBV buffer occupancy [%.1f]\n", defaults->rc.f_vbv_buffer_init );
     H2( "      --crf-max <float>       With CRF+VBV, limit RF to this value\n"
         "                                  May cause VBV underflows!\n" );
+    H2( "      --target-ssim <float>   With CRF, adjust the RF per scene to reach this\n"
+        "                                  mean SSIM, measured during encoding\n" );
     H2( "      --qpmin <integer>       Set min QP [%d]\n", defaults->rc.i_qp_min );
     H2( "      --qpmax <integer>       Set max QP [%d]\n", X264_MIN( defaults->rc.i_qp_max, QP_MAX ) );
     H2( "      --qpstep <integer>      Set max QP step [%d]\n", defaults->rc.i_qp_step );
@@ -761,6 +816,8 @@ static void help( x264_param_t *defaults, int longhelp )
         "                                  - 2: Last pass, does not overwrite stats file\n" );
     H2( "                                  - 3: Nth pass, overwrites stats file\n" );
     H1( "      --stats <string>        Filename for 2 pass stats [\"%s\"]\n", defaults->rc.psz_stat_out );
+    H2( "      --stats-only            First pass: only write the stats file, sizing\n"
+        "                              CABAC instead of coding it; no video is output\n" );
     H2( "      --no-mbtree             Disable mb-tree ratecontrol.\n");
     H2( "      --qcomp <float>         QP curve compression [%.2f]\n", defaults->rc.f_qcompress );
     H2( "      --cplxblur <float>      Reduce fluctuations in QP (before curve compression) [%.1f]\n", defaults->rc.f_complexity_blur );
@@ -776,6 +833,11 @@ static void help( x264_param_t *defaults, int longhelp )
         "                              QP is optional (none lets x264 choose). Frametypes: I,i,K,P,B,b.\n"
         "                                  K=<I or i> depending on open-gop setting\n"
         "                              QPs are restricted by qpmin/qpmax.\n" );
+    H2( "      --speed <float>         Adjust the analysis settings frame by frame to\n"
+        "                                  hold this fraction of realtime encoding speed.\n"
+        "                                  The given settings are never exceeded.\n"
+        "                                  Can't be used with zones that set options.\n" );
+    H2( "      --speed-bufsize <int>   Frames of slack for speed control [%d]\n", defaults->sc.i_buffer_size );
     H1( "\n" );
     H1( "Analysis:\n" );
     H1( "\n" );
@@ -827,7 +889,11 @@ static void help( x264_param_t *defaults, int longhelp )
         "                                  - 1: enabled only on the final encode of a MB\n"
         "                                  - 2: enabled on all mode decisions\n", defaults->analyse.i_trellis );
     H2( "      --no-fast-pskip         Disables early SKIP detection on P-frames\n" );
+    H2( "      --fast-rd-rate          Faster, less accurate CABAC bit estimation in RD\n"
+        "                                  (residual costs don't adapt within a MB)\n" );
     H2( "      --no-dct-decimate       Disables coefficient thresholding on P-frames\n" );
+    H2( "      --static-detect         Skip analysis of macroblocks identical to the\n"
+        "                                  previous input frame (screen content)\n" );
     H1( "      --nr <integer>          Noise reduction [%d]\n", defaults->analyse.i_noise_reduction );
     H2( "\n" );
     H2( "      --deadzone-inter <int>  Set the size of the inter luma quantization deadzone [%d]\n", defaults->analyse.i_luma_deadzone[0] );
@@ -898,8 +964,26 @@ static void help( x264_param_t *defaults, int longhelp )
     H0( "Input/Output:\n" );
     H0( "\n" );
     H0( "  -o, --output <string>       Specify output file\n" );
+    H1( "      --rendition <string>    Also encode the input at another resolution, sharing\n"
+        "                                  the decode and --vf filters (up to %d times):\n"
+        "                                  <width>x<height>,<output>[,<option>=<value>...]\n"
+        "                                  Options are encoder settings applied on top of\n"
+        "                                  the main ones (e.g. bitrate=800,vbv-maxrate=900),\n"
+        "                                  or profile. Values can't contain commas.\n"
+        "                                  Each rendition is fed from a thread of its own.\n", MAX_RENDITIONS );
+    H1( "      --tee <string>          Also write the output to this file, in the container\n"
+        "                                  its extension selects (up to %d times); each output\n"
+        "                                  is written in a thread of its own, with an output\n"
+        "                                  queue of 8 unless --output-queue says otherwise\n", MAX_TEE_OUTPUTS );
     H1( "      --muxer <string>        Specify output container format [\"%s\"]\n"
         "                                  - %s\n", x264_muxer_names[0], stringify_names( buf, x264_muxer_names ) );
+    H1( "      --fragment-duration <float> Fragmented MP4: cut a fragment every this many\n"
+        "                                  seconds, forcing a keyframe there [0: at keyframes]\n"
+        "                                  A %%d in the output name (e.g. seg%%05d.m4s) writes\n"
+        "                                  each fragment to a file of its own\n" );
+    H1( "      --hls                   Fragmented MP4: write an HLS playlist of the segment\n"
+        "                                  files, named without the number (e.g. seg.m3u8)\n" );
+    H2( "      --hls-list-size <integer> Number of segments a live HLS playlist keeps [0: all]\n" );
     H1( "      --demuxer <string>      Specify input container format [\"%s\"]\n"
         "                                  - %s\n", x264_demuxer_names[0], stringify_names( buf, x264_demuxer_names ) );
     H1( "      --input-fmt <string>    Specify input file format (requires lavf support)\n" );
@@ -915,6 +999,9 @@ static void help( x264_param_t *defaults, int longhelp )
         stringify_names( buf, x264_output_csp_names ) );
     H1( "      --input-depth <integer> Specify input bit depth for raw input\n" );
     H1( "      --output-depth <integer> Specify output bit depth\n" );
+    H1( "      --dither <string>       Dithering used to lower the bit depth [\"%s\"]\n"
+        "                                  - diffusion: Sierra-2-4A error diffusion\n"
+        "                                  - ordered: Bayer matrix, much faster\n", x264_dither_names[0] );
     H1( "      --input-range <string>  Specify input color range [\"%s\"]\n"
         "                                  - %s\n", x264_range_names[0], stringify_names( buf, x264_range_names ) );
     H1( "      --input-res <intxint>   Specify input resolution (width x height)\n" );
@@ -940,10 +1027,21 @@ static void help( x264_param_t *defaults, int longhelp )
                                        stringify_names( buf, x264_log_level_names ) );
     H1( "      --psnr                  Enable PSNR computation\n" );
     H1( "      --ssim                  Enable SSIM computation\n" );
+    H1( "      --vif                   Enable VIF (visual information fidelity) computation\n" );
     H1( "      --threads <integer>     Force a specific number of threads\n" );
     H2( "      --lookahead-threads <integer> Force a specific number of lookahead threads\n" );
     H2( "      --sliced-threads        Low-latency but lower-efficiency threading\n" );
+    H2( "      --cabac-thread          Write the CABAC bitstream in a separate thread,\n"
+        "                                  pipelined with analysis of the following MBs\n"
+        "                                  Ignored with subme >= 6, trellis, VBV,\n"
+        "                                  slice-max-size or interlaced\n" );
     H2( "      --thread-input          Run Avisynth in its own thread\n" );
+    H2( "      --input-queue <integer> Number of frames threaded input reads ahead [1]\n" );
+    H2( "      --filter-queue <integer> Run each video filter that works on the pixels\n"
+        "                                  (not crop or select_every) in its own\n"
+        "                                  thread, queueing this many frames after it [0]\n" );
+    H2( "      --output-queue <integer> Write the output in its own thread,\n"
+        "                                  queueing up to this many frames [0, 8 with --tee]\n" );
     H2( "      --sync-lookahead <integer> Number of buffer frames for threaded lookahead\n" );
     H2( "      --non-deterministic     Slightly improve quality of SMP, at the cost of repeatability\n" );
     H2( "      --cpu-independent       Ensure exact reproducibility across different cpus,\n"
@@ -959,6 +1057,11 @@ static void help( x264_param_t *defaults, int longhelp )
     H2( "      --force-cfr             Force constant framerate timestamp generation\n" );
     H2( "      --tcfile-in <string>    Force timestamp generation with timecode file\n" );
     H2( "      --tcfile-out <string>   Output timecode v2 file from input timestamps\n" );
+    H2( "      --mb-stats <string>     Enable the mb-stats param and write the per-macroblock\n"
+        "                              qp, ssd and ssim of each frame to a file\n"
+        "                              Binary, native byte order. For each frame in output order:\n"
+        "                                  int64 pts, int32 type, int32 mb_width, int32 mb_height,\n"
+        "                                  then int8 qp, uint32 ssd and float ssim for each mb\n" );
     H2( "      --timebase <int/int>    Specify timebase numerator and denominator\n"
         "                 <integer>    Specify timebase numerator for input timecode file\n"
         "                              or specify timebase denominator for other input\n" );
@@ -982,6 +1085,12 @@ typedef enum
     OPT_SEEK,
     OPT_QPFILE,
     OPT_THREAD_INPUT,
+    OPT_INPUT_QUEUE,
+    OPT_OUTPUT_QUEUE,
+    OPT_FRAGMENT_DURATION,
+    OPT_HLS,
+    OPT_HLS_LIST_SIZE,
+    OPT_FILTER_QUEUE,
     OPT_QUIET,
     OPT_NOPROGRESS,
     OPT_LONGHELP,
@@ -997,6 +1106,7 @@ typedef enum
     OPT_INTERLACED,
     OPT_TCFILE_IN,
     OPT_TCFILE_OUT,
+    OPT_MB_STATS,
     OPT_TIMEBASE,
     OPT_PULLDOWN,
     OPT_LOG_LEVEL,
@@ -1006,6 +1116,9 @@ typedef enum
     OPT_INPUT_CSP,
     OPT_INPUT_DEPTH,
     OPT_OUTPUT_DEPTH,
+    OPT_DITHER,
+    OPT_RENDITION,
+    OPT_TEE,
     OPT_DTS_COMPRESSION,
     OPT_OUTPUT_CSP,
     OPT_INPUT_RANGE,
@@ -1093,7 +1206,9 @@ static struct option long_options[] =
     { "trellis",              required_argument, NULL, 't' },
     { "fast-pskip",           no_argument,       NULL, 0 },
     { "no-fast-pskip",        no_argument,       NULL, 0 },
+    { "fast-rd-rate",         no_argument,       NULL, 0 },
     { "no-dct-decimate",      no_argument,       NULL, 0 },
+    { "static-detect",        no_argument,       NULL, 0 },
     { "aq-strength",          required_argument, NULL, 0 },
     { "aq-mode",              required_argument, NULL, 0 },
     { "deadzone-inter",       required_argument, NULL, 0 },
@@ -1104,11 +1219,13 @@ static struct option long_options[] =
     { "vbv-bufsize",          required_argument, NULL, 0 },
     { "vbv-init",             required_argument, NULL, 0 },
     { "crf-max",              required_argument, NULL, 0 },
+    { "target-ssim",          required_argument, NULL, 0 },
     { "ipratio",              required_argument, NULL, 0 },
     { "pbratio",              required_argument, NULL, 0 },
     { "chroma-qp-offset",     required_argument, NULL, 0 },
     { "pass",                 required_argument, NULL, 'p' },
     { "stats",                required_argument, NULL, 0 },
+    { "stats-only",           no_argument,       NULL, 0 },
     { "qcomp",                required_argument, NULL, 0 },
     { "mbtree",               no_argument,       NULL, 0 },
     { "no-mbtree",            no_argument,       NULL, 0 },
@@ -1116,21 +1233,31 @@ static struct option long_options[] =
     { "cplxblur",             required_argument, NULL, 0 },
     { "zones",                required_argument, NULL, 0 },
     { "qpfile",               required_argument, NULL, OPT_QPFILE },
+    { "speed",                required_argument, NULL, 0 },
+    { "speed-bufsize",        required_argument, NULL, 0 },
     { "threads",              required_argument, NULL, 0 },
     { "lookahead-threads",    required_argument, NULL, 0 },
     { "sliced-threads",       no_argument,       NULL, 0 },
     { "no-sliced-threads",    no_argument,       NULL, 0 },
+    { "cabac-thread",         no_argument,       NULL, 0 },
     { "slice-max-size",       required_argument, NULL, 0 },
     { "slice-max-mbs",        required_argument, NULL, 0 },
     { "slice-min-mbs",        required_argument, NULL, 0 },
     { "slices",               required_argument, NULL, 0 },
     { "slices-max",           required_argument, NULL, 0 },
     { "thread-input",         no_argument,       NULL, OPT_THREAD_INPUT },
+    { "input-queue",          required_argument, NULL, OPT_INPUT_QUEUE },
+    { "output-queue",         required_argument, NULL, OPT_OUTPUT_QUEUE },
+    { "fragment-duration",    required_argument, NULL, OPT_FRAGMENT_DURATION },
+    { "hls",                  no_argument,       NULL, OPT_HLS },
+    { "hls-list-size",        required_argument, NULL, OPT_HLS_LIST_SIZE },
+    { "filter-queue",         required_argument, NULL, OPT_FILTER_QUEUE },
     { "sync-lookahead",       required_argument, NULL, 0 },
     { "non-deterministic",    no_argument,       NULL, 0 },
     { "cpu-independent",      no_argument,       NULL, 0 },
     { "psnr",                 no_argument,       NULL, 0 },
     { "ssim",                 no_argument,       NULL, 0 },
+    { "vif",                  no_argument,       NULL, 0 },
     { "quiet",                no_argument,       NULL, OPT_QUIET },
     { "verbose",              no_argument,       NULL, 'v' },
     { "log-level",            required_argument, NULL, OPT_LOG_LEVEL },
@@ -1161,6 +1288,7 @@ static struct option long_options[] =
     { "force-cfr",            no_argument,       NULL, 0 },
     { "tcfile-in",            required_argument, NULL, OPT_TCFILE_IN },
     { "tcfile-out",           required_argument, NULL, OPT_TCFILE_OUT },
+    { "mb-stats",             required_argument, NULL, OPT_MB_STATS },
     { "timebase",             required_argument, NULL, OPT_TIMEBASE },
     { "pic-struct",           no_argument,       NULL, 0 },
     { "crop-rect",            required_argument, NULL, 0 },
@@ -1178,6 +1306,9 @@ static struct option long_options[] =
     { "input-csp",            required_argument, NULL, OPT_INPUT_CSP },
     { "input-depth",          required_argument, NULL, OPT_INPUT_DEPTH },
     { "output-depth",         required_argument, NULL, OPT_OUTPUT_DEPTH },
+    { "dither",               required_argument, NULL, OPT_DITHER },
+    { "rendition",            required_argument, NULL, OPT_RENDITION },
+    { "tee",                  required_argument, NULL, OPT_TEE },
     { "dts-compress",         no_argument,       NULL, OPT_DTS_COMPRESSION },
     { "output-csp",           required_argument, NULL, OPT_OUTPUT_CSP },
     { "input-range",          required_argument, NULL, OPT_INPUT_RANGE },
@@ -1186,7 +1317,23 @@ static struct option long_options[] =
     { NULL,                   0,                 NULL, 0 }
 };
 
-static int select_output( const char *muxer, char *filename, x264_param_t *param )
+/* Move an opened output into a writer thread of its own, if an output queue was asked for. */
+static int open_output_thread( cli_output_t *output, hnd_t *hout, cli_output_opt_t *output_opt )
+{
+#if HAVE_THREAD
+    if( output_opt->queue_size > 0 )
+    {
+        output_opt->writer_output = output;
+        FAIL_IF_ERROR( thread_output.open_file( NULL, hout, output_opt ), "threaded output failed\n" );
+        *output = thread_output;
+    }
+#endif
+    return 0;
+}
+
+/* Sets *b_fmp4 if the output is fragmented MP4, which is what --fragment-duration
+ * forces keyframes for. */
+static int select_output( const char *muxer, char *filename, x264_param_t *param, cli_output_t *output, int *b_fmp4 )
 {
     const char *ext = get_filename_extension( filename );
     if( !strcmp( filename, "-" ) || strcasecmp( muxer, "auto" ) )
@@ -1195,7 +1342,7 @@ static int select_output( const char *muxer, char *filename, x264_param_t *param
     if( !strcasecmp( ext, "mp4" ) )
     {
 #if HAVE_GPAC || HAVE_LSMASH
-        cli_output = mp4_output;
+        *output = mp4_output;
         param->b_annexb = 0;
         param->b_repeat_headers = 0;
         if( param->i_nal_hrd == X264_NAL_HRD_CBR )
@@ -1210,21 +1357,86 @@ static int select_output( const char *muxer, char *filename, x264_param_t *param
     }
     else if( !strcasecmp( ext, "mkv" ) )
     {
-        cli_output = mkv_output;
+        *output = mkv_output;
         param->b_annexb = 0;
         param->b_repeat_headers = 0;
     }
     else if( !strcasecmp( ext, "flv" ) )
     {
-        cli_output = flv_output;
+        *output = flv_output;
+        param->b_annexb = 0;
+        param->b_repeat_headers = 0;
+    }
+    else if( !strcasecmp( ext, "fmp4" ) || !strcasecmp( ext, "m4s" ) || !strcasecmp( ext, "cmfv" ) )
+    {
+        *output = fmp4_output;
         param->b_annexb = 0;
         param->b_repeat_headers = 0;
+        *b_fmp4 = 1;
     }
     else
-        cli_output = raw_output;
+        *output = raw_output;
     return 0;
 }
 
+/* Open the main output and the --tee ones behind a tee output, each in a
+ * writer thread of its own. The stream is set up to suit all of them. */
+static int open_tee( const char *muxer, char *filename, char **tee_filenames, int i_tee, x264_param_t *param,
+                     cli_output_opt_t *output_opt, cli_output_t *output, hnd_t *hout, int *b_fmp4 )
+{
+    cli_output_t outputs[MAX_TEE_OUTPUTS+1];
+    cli_tee_branch_t branch[MAX_TEE_OUTPUTS+1];
+    cli_output_opt_t branch_opt = *output_opt;
+    int b_annexb = param->b_annexb;
+    int b_repeat_headers = param->b_repeat_headers;
+    int i_opened = 0;
+
+    /* Queue a few frames for each output unless told how many; with
+     * --output-queue 0 they're all written in turn from the encoding thread. */
+    if( branch_opt.queue_size < 0 )
+        branch_opt.queue_size = 8;
+
+    for( ; i_opened <= i_tee; i_opened++ )
+    {
+        char *name = i_opened ? tee_filenames[i_opened-1] : filename;
+        x264_param_t branch_param = *param;
+        branch_param.b_annexb = b_annexb;
+        branch_param.b_repeat_headers = b_repeat_headers;
+        if( select_output( i_opened ? "auto" : muxer, name, &branch_param, &outputs[i_opened], b_fmp4 ) )
+            goto fail;
+        param->b_annexb &= branch_param.b_annexb;
+        param->b_repeat_headers &= branch_param.b_repeat_headers;
+        param->i_nal_hrd = X264_MIN( param->i_nal_hrd, branch_param.i_nal_hrd );
+        branch[i_opened].b_annexb = branch_param.b_annexb;
+        branch[i_opened].output = &outputs[i_opened];
+        if( outputs[i_opened].open_file( name, &branch[i_opened].handle, output_opt ) )
+        {
+            x264_cli_log( "x264", X264_LOG_ERROR, "could not open output file `%s'\n", name );
+            goto fail;
+        }
+        if( open_output_thread( &outputs[i_opened], &branch[i_opened].handle, &branch_opt ) )
+        {
+            outputs[i_opened].close_file( branch[i_opened].handle, 0, 0 );
+            goto fail;
+        }
+    }
+
+    output_opt->tee = branch;
+    output_opt->tee_count = i_tee + 1;
+    int ret = tee_output.open_file( NULL, hout, output_opt );
+    output_opt->tee = NULL;
+    output_opt->tee_count = 0;
+    if( !ret )
+    {
+        *output = tee_output;
+        return 0;
+    }
+fail:
+    while( i_opened-- )
+        outputs[i_opened].close_file( branch[i_opened].handle, 0, 0 );
+    return -1;
+}
+
 static int select_input( const char *demuxer, char *used_demuxer, char *filename,
                          hnd_t *p_handle, video_info_t *info, cli_input_opt_t *opt )
 {
@@ -1302,16 +1514,41 @@ static int select_input( const char *demuxer, char *used_demuxer, char *filename
     return 0;
 }
 
-static int init_vid_filters( char *sequence, hnd_t *handle, video_info_t *info, x264_param_t *param, int output_csp )
+/* Filters that only pass frames on, with new offsets into the planes or new
+ * timestamps, take less time than the copy a queue makes of each frame. */
+static const char * const light_filter_names[] = { "crop", "select_every", "fix_vfr_pts", 0 };
+
+/* Initialize a filter and, if it installed itself and does real work on the
+ * pixels, run it in a thread of its own. */
+static int init_vid_filter( const char *name, hnd_t *handle, cli_vid_filter_t *vfilter, video_info_t *info,
+                            x264_param_t *param, char *opt_string, int queue_size )
+{
+    hnd_t prev_hnd = *handle;
+    if( x264_init_vid_filter( name, handle, vfilter, info, param, opt_string ) )
+        return -1;
+#if HAVE_THREAD
+    for( int i = 0; light_filter_names[i]; i++ )
+        if( !strcmp( name, light_filter_names[i] ) )
+            queue_size = 0;
+    if( queue_size > 0 && *handle != prev_hnd )
+    {
+        if( x264_init_vid_filter( "thread", handle, vfilter, info, param, (char*)(intptr_t)queue_size ) )
+            return -1;
+    }
+#endif
+    return 0;
+}
+
+static int init_vid_filters( char *sequence, hnd_t *handle, video_info_t *info, x264_param_t *param, int queue_size )
 {
     x264_register_vid_filters();
 
     /* initialize baseline filters */
     if( x264_init_vid_filter( "source", handle, &filter, info, param, NULL ) ) /* wrap demuxer into a filter */
         return -1;
-    if( x264_init_vid_filter( "resize", handle, &filter, info, param, "normcsp" ) ) /* normalize csps to be of a known/supported format */
+    if( init_vid_filter( "resize", handle, &filter, info, param, "normcsp", queue_size ) ) /* normalize csps to be of a known/supported format */
         return -1;
-    if( x264_init_vid_filter( "fix_vfr_pts", handle, &filter, info, param, NULL ) ) /* fix vfr pts */
+    if( init_vid_filter( "fix_vfr_pts", handle, &filter, info, param, NULL, queue_size ) ) /* fix vfr pts */
         return -1;
 
     /* parse filter chain */
@@ -1323,11 +1560,18 @@ static int init_vid_filters( char *sequence, hnd_t *handle, video_info_t *info,
         int name_len = strcspn( p, ":" );
         p[name_len] = 0;
         name_len += name_len != tok_len;
-        if( x264_init_vid_filter( p, handle, &filter, info, param, p + name_len ) )
+        if( init_vid_filter( p, handle, &filter, info, param, p + name_len, queue_size ) )
             return -1;
         p += X264_MIN( tok_len+1, p_len );
     }
 
+    return 0;
+}
+
+/* Convert the filtered video to what the encoder takes. */
+static int init_output_filters( hnd_t *handle, cli_vid_filter_t *vfilter, video_info_t *info, x264_param_t *param,
+                                int output_csp, const char *dither, int queue_size )
+{
     /* force end result resolution */
     if( !param->i_width && !param->i_height )
     {
@@ -1352,16 +1596,81 @@ static int init_vid_filters( char *sequence, hnd_t *handle, video_info_t *info,
     if( param->vui.b_fullrange == RANGE_AUTO )
         param->vui.b_fullrange = info->fullrange;
 
-    if( x264_init_vid_filter( "resize", handle, &filter, info, param, NULL ) )
+    if( init_vid_filter( "resize", handle, vfilter, info, param, NULL, queue_size ) )
         return -1;
 
-    char args[20], name[20];
-    sprintf( args, "bit_depth=%d", param->i_bitdepth );
+    char args[40], name[20];
+    sprintf( args, "bit_depth=%d,dither=%s", param->i_bitdepth, dither );
     sprintf( name, "depth_%d", param->i_bitdepth );
 
-    if( x264_init_vid_filter( name, handle, &filter, info, param, args ) )
+    if( init_vid_filter( name, handle, vfilter, info, param, args, queue_size ) )
+        return -1;
+
+    return 0;
+}
+
+/* <width>x<height>,<output>[,<option>=<value>...]
+ * The rendition starts out with the main encode's settings, and its filter
+ * branch with the fork. */
+static int init_rendition( cli_rendition_t *r, char *str, x264_param_t *param, x264_param_t *defaults,
+                           video_info_t info, cli_output_opt_t *output_opt, int output_csp, const char *dither, int *b_fmp4 )
+{
+    char *filename = strchr( str, ',' );
+    FAIL_IF_ERROR( !filename, "no output file for rendition `%s'\n", str );
+    *filename++ = 0;
+    char *opts = strchr( filename, ',' );
+    if( opts )
+        *opts++ = 0;
+    int width, height;
+    FAIL_IF_ERROR( sscanf( str, "%dx%d", &width, &height ) != 2 || width <= 0 || height <= 0,
+                   "invalid rendition resolution `%s'\n", str );
+
+    r->param = *param;
+    r->param.opaque = NULL; /* strings set by the main options stay owned by the main param */
+    r->param.psz_dump_yuv = NULL;
+    r->param.b_annexb = defaults->b_annexb;
+    r->param.b_repeat_headers = defaults->b_repeat_headers;
+    r->param.i_width = width;
+    r->param.i_height = height;
+    const char *profile = NULL;
+    for( char *p = opts; p && *p; )
+    {
+        char *next = strchr( p, ',' );
+        if( next )
+            *next++ = 0;
+        char *value = strchr( p, '=' );
+        if( value )
+            *value++ = 0;
+        if( !strcmp( p, "profile" ) )
+            profile = value;
+        else
+            FAIL_IF_ERROR( x264_param_parse( &r->param, p, value ), "invalid rendition option: %s = %s\n", p, x264_otos( value, "" ) );
+        p = next;
+    }
+    if( x264_param_apply_profile( &r->param, profile ) < 0 )
+        return -1;
+
+    r->filename = filename;
+    /* Its output queue is waited on in its own thread: count that apart. */
+    cli_output_opt_t r_output_opt = *output_opt;
+    r_output_opt.stall_time = &r->stall_time;
+    if( select_output( "auto", filename, &r->param, &r->output, b_fmp4 ) )
+        return -1;
+    FAIL_IF_ERROR( r->output.open_file( filename, &r->hout, &r_output_opt ), "could not open output file `%s'\n", filename );
+    if( open_output_thread( &r->output, &r->hout, &r_output_opt ) )
         return -1;
 
+    if( width != info.width || height != info.height )
+    {
+        char args[40];
+        sprintf( args, "%d,%d", width, height );
+        if( init_vid_filter( "scale", &r->hin, &r->filter, &info, &r->param, args, 0 ) )
+            return -1;
+    }
+    if( init_output_filters( &r->hin, &r->filter, &info, &r->param, output_csp, dither, 0 ) )
+        return -1;
+    r->param.vui.i_sar_width  = info.sar_width;
+    r->param.vui.i_sar_height = info.sar_height;
     return 0;
 }
 
@@ -1398,6 +1707,12 @@ static int parse( int argc, char **argv, x264_param_t *param, cli_opt_t *opt )
     char *profile = NULL;
     char *vid_filters = NULL;
     int b_thread_input = 0;
+    int i_filter_queue = 0;
+    const char *dither = x264_dither_names[0];
+    char *renditions[MAX_RENDITIONS];
+    int i_renditions = 0;
+    char *tee_filenames[MAX_TEE_OUTPUTS];
+    int i_tee = 0;
     int b_turbo = 1;
     int b_user_ref = 0;
     int b_user_fps = 0;
@@ -1432,6 +1747,8 @@ static int parse( int argc, char **argv, x264_param_t *param, cli_opt_t *opt )
 
     memset( &input_opt, 0, sizeof(cli_input_opt_t) );
     memset( &output_opt, 0, sizeof(cli_output_opt_t) );
+    output_opt.queue_size = -1;
+    output_opt.stall_time = &output_stall_time;
     input_opt.bit_depth = 8;
     input_opt.input_range = input_opt.output_range = param->vui.b_fullrange = RANGE_AUTO;
     int output_csp = defaults.i_csp;
@@ -1495,6 +1812,31 @@ static int parse( int argc, char **argv, x264_param_t *param, cli_opt_t *opt )
             case OPT_THREAD_INPUT:
                 b_thread_input = 1;
                 break;
+            case OPT_INPUT_QUEUE:
+                input_opt.queue_size = atoi( optarg );
+                FAIL_IF_ERROR( input_opt.queue_size < 1, "invalid input queue size: %s\n", optarg );
+                b_thread_input = 1;
+                break;
+            case OPT_OUTPUT_QUEUE:
+                output_opt.queue_size = atoi( optarg );
+                FAIL_IF_ERROR( output_opt.queue_size < 0, "invalid output queue size: %s\n", optarg );
+                break;
+            case OPT_FRAGMENT_DURATION:
+                output_opt.fragment_duration = atof( optarg );
+                FAIL_IF_ERROR( output_opt.fragment_duration < 0, "invalid fragment duration: %s\n", optarg );
+                opt->fragment_duration = output_opt.fragment_duration;
+                break;
+            case OPT_HLS:
+                output_opt.hls = 1;
+                break;
+            case OPT_HLS_LIST_SIZE:
+                output_opt.hls_list_size = atoi( optarg );
+                FAIL_IF_ERROR( output_opt.hls_list_size < 0, "invalid HLS list size: %s\n", optarg );
+                break;
+            case OPT_FILTER_QUEUE:
+                i_filter_queue = atoi( optarg );
+                FAIL_IF_ERROR( i_filter_queue < 0, "invalid filter queue size: %s\n", optarg );
+                break;
             case OPT_QUIET:
                 cli_log_level = param->i_log_level = X264_LOG_NONE;
                 break;
@@ -1537,6 +1879,11 @@ static int parse( int argc, char **argv, x264_param_t *param, cli_opt_t *opt )
                 opt->tcfile_out = x264_fopen( optarg, "wb" );
                 FAIL_IF_ERROR( !opt->tcfile_out, "can't open `%s'\n", optarg );
                 break;
+            case OPT_MB_STATS:
+                opt->mb_stats = x264_fopen( optarg, "wb" );
+                FAIL_IF_ERROR( !opt->mb_stats, "can't open `%s'\n", optarg );
+                param->analyse.b_mb_stats = 1;
+                break;
             case OPT_TIMEBASE:
                 input_opt.timebase = optarg;
                 break;
@@ -1574,6 +1921,17 @@ static int parse( int argc, char **argv, x264_param_t *param, cli_opt_t *opt )
 #endif
                 param->i_csp = output_csp = output_csp_fix[output_csp];
                 break;
+            case OPT_RENDITION:
+                FAIL_IF_ERROR( i_renditions == MAX_RENDITIONS, "too many renditions (max %d)\n", MAX_RENDITIONS );
+                renditions[i_renditions++] = optarg;
+                break;
+            case OPT_TEE:
+                FAIL_IF_ERROR( i_tee == MAX_TEE_OUTPUTS, "too many tee outputs (max %d)\n", MAX_TEE_OUTPUTS );
+                tee_filenames[i_tee++] = optarg;
+                break;
+            case OPT_DITHER:
+                FAIL_IF_ERROR( parse_enum_name( optarg, x264_dither_names, &dither ), "Unknown dither mode `%s'\n", optarg );
+                break;
             case OPT_INPUT_RANGE:
                 FAIL_IF_ERROR( parse_enum_value( optarg, x264_range_names, &input_opt.input_range ), "Unknown input range `%s'\n", optarg );
                 input_opt.input_range += RANGE_AUTO;
@@ -1620,13 +1978,34 @@ generic_option:
     if( x264_param_apply_profile( param, profile ) < 0 )
         return -1;
 
+    /* A stats-only first pass outputs no video, so it needs no output file. */
+    int b_stats_only = param->rc.b_stats_only && param->rc.b_stat_write && !param->rc.b_stat_read;
+
     /* Get the file name */
-    FAIL_IF_ERROR( optind > argc - 1 || !output_filename, "No %s file. Run x264 --help for a list of options.\n",
+    FAIL_IF_ERROR( optind > argc - 1 || (!output_filename && !b_stats_only), "No %s file. Run x264 --help for a list of options.\n",
                    optind > argc - 1 ? "input" : "output" );
 
-    if( select_output( muxer, output_filename, param ) )
-        return -1;
-    FAIL_IF_ERROR( cli_output.open_file( output_filename, &opt->hout, &output_opt ), "could not open output file `%s'\n", output_filename );
+    int b_fmp4 = 0;
+    if( b_stats_only )
+    {
+        /* The usual first pass writes to the null device, so only warn about real files. */
+        if( output_filename && strcmp( output_filename, "/dev/null" ) && strcasecmp( output_filename, "NUL" ) )
+            x264_cli_log( "x264", X264_LOG_WARNING, "--stats-only outputs no video, `%s' will not be written\n", output_filename );
+        opt->hout = NULL;
+    }
+    else if( i_tee )
+    {
+        if( open_tee( muxer, output_filename, tee_filenames, i_tee, param, &output_opt, &cli_output, &opt->hout, &b_fmp4 ) )
+            return -1;
+    }
+    else
+    {
+        if( select_output( muxer, output_filename, param, &cli_output, &b_fmp4 ) )
+            return -1;
+        FAIL_IF_ERROR( cli_output.open_file( output_filename, &opt->hout, &output_opt ), "could not open output file `%s'\n", output_filename );
+        if( open_output_thread( &cli_output, &opt->hout, &output_opt ) )
+            return -1;
+    }
 
     input_filename = argv[optind++];
     video_info_t info = {0};
@@ -1676,29 +2055,21 @@ generic_option:
 
     /* init threaded input while the information about the input video is unaltered by filtering */
 #if HAVE_THREAD
-    const cli_input_t *thread_input;
-#if HAVE_BITDEPTH8
-    if( param->i_bitdepth == 8 )
-        thread_input = &thread_8_input;
-    else
-#endif
-#if HAVE_BITDEPTH10
-    if( param->i_bitdepth == 10 )
-        thread_input = &thread_10_input;
-    else
-#endif
-        thread_input = NULL;
-
-    if( thread_input && info.thread_safe && (b_thread_input || param->i_threads > 1
+    if( info.thread_safe && (b_thread_input || param->i_threads > 1
         || (param->i_threads == X264_THREADS_AUTO && x264_cpu_num_processors() > 1)) )
     {
-        if( thread_input->open_file( NULL, &opt->hin, &info, NULL ) )
+        if( thread_input.open_file( NULL, &opt->hin, &info, &input_opt ) )
         {
             fprintf( stderr, "x264 [error]: threaded input failed\n" );
             return -1;
         }
-        cli_input = *thread_input;
+        cli_input = thread_input;
     }
+    else if( input_opt.queue_size )
+        x264_cli_log( "x264", X264_LOG_WARNING, "--input-queue is ignored, the input can't be read from a thread\n" );
+#else
+    if( input_opt.queue_size )
+        x264_cli_log( "x264", X264_LOG_WARNING, "--input-queue is ignored, x264 was built without threads\n" );
 #endif
 
     /* override detected values by those specified by the user */
@@ -1744,7 +2115,29 @@ generic_option:
     if( input_opt.input_range != RANGE_AUTO )
         info.fullrange = input_opt.input_range;
 
-    if( init_vid_filters( vid_filters, &opt->hin, &info, param, output_csp ) )
+    if( init_vid_filters( vid_filters, &opt->hin, &info, param, i_filter_queue ) )
+        return -1;
+
+    /* Renditions branch off here. The branches take frames from the fork in
+     * lockstep, so nothing past it may read ahead in a thread. */
+    video_info_t fork_info = info;
+    if( i_renditions )
+    {
+        FAIL_IF_ERROR( x264_init_vid_filter( "fork", &opt->hin, &filter, &info, param, (char*)(intptr_t)(i_renditions + 1) ),
+                       "could not fork the filter chain\n" );
+        fork_info = info;
+        opt->rendition = calloc( i_renditions, sizeof(cli_rendition_t) );
+        FAIL_IF_ERROR( !opt->rendition, "malloc failed\n" );
+        opt->i_renditions = i_renditions;
+        for( int i = 0; i < i_renditions; i++ )
+        {
+            opt->rendition[i].hin = opt->hin;
+            opt->rendition[i].filter = filter;
+        }
+        i_filter_queue = 0;
+    }
+
+    if( init_output_filters( &opt->hin, &filter, &info, param, output_csp, dither, i_filter_queue ) )
         return -1;
 
     /* set param flags from the post-filtered video */
@@ -1798,6 +2191,26 @@ generic_option:
             }
     }
 
+    for( int i = 0; i < i_renditions; i++ )
+        if( init_rendition( &opt->rendition[i], renditions[i], param, &defaults, fork_info,
+                            &output_opt, output_csp, dither, &b_fmp4 ) )
+            return -1;
+
+    /* Only fragmented MP4 output is cut into fragments; don't force keyframes for any other. */
+    if( opt->fragment_duration && !b_fmp4 )
+    {
+        x264_cli_log( "x264", X264_LOG_WARNING, "--fragment-duration is only used with fragmented MP4 output, ignoring\n" );
+        opt->fragment_duration = 0;
+    }
+    for( int i = 0; i < i_renditions; i++ )
+        for( int j = -1; j < i; j++ )
+        {
+            x264_param_t *a = &opt->rendition[i].param;
+            x264_param_t *b = j < 0 ? param : &opt->rendition[j].param;
+            FAIL_IF_ERROR( (a->rc.b_stat_write && b->rc.b_stat_write && !strcmp( a->rc.psz_stat_out, b->rc.psz_stat_out )) ||
+                           (a->rc.b_stat_read && b->rc.b_stat_read && !strcmp( a->rc.psz_stat_in, b->rc.psz_stat_in )),
+                           "rendition `%s' needs a stats file of its own (stats=<filename>)\n", opt->rendition[i].filename );
+        }
 
     return 0;
 }
@@ -1852,7 +2265,24 @@ static void parse_qpfile( cli_opt_t *opt, x264_picture_t *pic, int i_frame )
     }
 }
 
-static int encode_frame( x264_t *h, hnd_t hout, x264_picture_t *pic, int64_t *last_dts )
+static int write_mb_stats( FILE *f, x264_param_t *param, x264_picture_t *pic )
+{
+    int32_t hdr[3];
+    hdr[0] = pic->i_type;
+    hdr[1] = (param->i_width + 15) >> 4;
+    hdr[2] = param->b_interlaced ? ((param->i_height + 31) >> 5) << 1 : (param->i_height + 15) >> 4;
+    size_t mb_count = hdr[1] * hdr[2];
+    if( fwrite( &pic->i_pts, sizeof(int64_t), 1, f ) != 1 ||
+        fwrite( hdr, sizeof(hdr), 1, f ) != 1 ||
+        fwrite( pic->prop.mb_qp, sizeof(int8_t), mb_count, f ) != mb_count ||
+        fwrite( pic->prop.mb_ssd, sizeof(uint32_t), mb_count, f ) != mb_count ||
+        fwrite( pic->prop.mb_ssim, sizeof(float), mb_count, f ) != mb_count )
+        return -1;
+    return 0;
+}
+
+static int encode_frame( x264_t *h, cli_output_t *output, hnd_t hout, FILE *mb_stats,
+                         x264_param_t *param, x264_picture_t *pic, int64_t *last_dts )
 {
     x264_picture_t pic_out;
     x264_nal_t *nal;
@@ -1865,8 +2295,12 @@ static int encode_frame( x264_t *h, hnd_t hout, x264_picture_t *pic, int64_t *la
 
     if( i_frame_size )
     {
-        i_frame_size = cli_output.write_frame( hout, nal[0].p_payload, i_frame_size, &pic_out );
+        /* A stats-only pass returns the estimated frame size but nothing to write. */
+        if( i_nal )
+            i_frame_size = output->write_frame( hout, nal[0].p_payload, i_frame_size, &pic_out );
         *last_dts = pic_out.i_dts;
+        if( mb_stats )
+            FAIL_IF_ERROR( write_mb_stats( mb_stats, param, &pic_out ) < 0, "error writing mb stats\n" );
     }
 
     return i_frame_size;
@@ -1894,6 +2328,8 @@ static int64_t print_status( int64_t i_start, int64_t i_previous, int i_frame, i
     }
     else
         sprintf( buf, "x264 %d frames: %.2f fps, %.2f kb/s", i_frame, fps, bitrate );
+    if( output_stall_time >= 100000 )
+        sprintf( buf + strlen( buf ), ", output stall %.1fs", output_stall_time / 1e6 );
     fprintf( stderr, "%s  \r", buf+5 );
     x264_cli_set_console_title( buf );
     fflush( stderr ); // needed in windows
@@ -1909,6 +2345,148 @@ static void convert_cli_to_lib_pic( x264_picture_t *lib, cli_pic_t *cli )
     lib->i_pts = cli->pts;
 }
 
+static int encode_rendition_frame( cli_rendition_t *r, x264_picture_t *pic )
+{
+    int64_t last_dts;
+    int i_frame_size = encode_frame( r->h, &r->output, r->hout, NULL, &r->param, pic, &last_dts );
+    if( i_frame_size > 0 )
+    {
+        r->i_file += i_frame_size;
+        r->i_frame_output++;
+    }
+    return i_frame_size;
+}
+
+/* Encode the rendition's version of the main encode's current picture, with
+ * the same timing and forced frame type. */
+static int encode_rendition( cli_rendition_t *r, x264_picture_t *main_pic, int i_frame )
+{
+    cli_pic_t cli_pic;
+    x264_picture_t pic;
+    FAIL_IF_ERROR( r->filter.get_frame( r->hin, &cli_pic, i_frame ), "rendition `%s' is missing frame %d\n", r->filename, i_frame );
+    x264_picture_init( &pic );
+    convert_cli_to_lib_pic( &pic, &cli_pic );
+    pic.i_pts = main_pic->i_pts;
+    pic.i_pic_struct = main_pic->i_pic_struct;
+    pic.i_type = main_pic->i_type;
+    pic.i_qpplus1 = main_pic->i_qpplus1;
+    int ret = encode_rendition_frame( r, &pic );
+    if( r->filter.release_frame( r->hin, &cli_pic, i_frame ) )
+        ret = -1;
+    return ret;
+}
+
+static int run_rendition_job( cli_rendition_t *r )
+{
+    if( !r->b_flush )
+        return encode_rendition( r, &r->pic, r->i_frame );
+    while( !b_ctrl_c && x264_encoder_delayed_frames( r->h ) )
+        if( encode_rendition_frame( r, NULL ) < 0 )
+            return -1;
+    return 0;
+}
+
+#if HAVE_THREAD
+static void *rendition_thread( cli_rendition_t *r )
+{
+    x264_pthread_mutex_lock( &r->mutex );
+    for( ;; )
+    {
+        while( !r->b_busy && !r->b_stop )
+            x264_pthread_cond_wait( &r->cv, &r->mutex );
+        if( !r->b_busy )
+            break;
+        x264_pthread_mutex_unlock( &r->mutex );
+
+        int ret = run_rendition_job( r );
+
+        x264_pthread_mutex_lock( &r->mutex );
+        r->ret = ret;
+        r->b_busy = 0;
+        x264_pthread_cond_broadcast( &r->cv );
+    }
+    x264_pthread_mutex_unlock( &r->mutex );
+    return NULL;
+}
+#endif
+
+static int start_rendition_thread( cli_rendition_t *r )
+{
+#if HAVE_THREAD
+    if( x264_pthread_mutex_init( &r->mutex, NULL ) )
+        return -1;
+    if( x264_pthread_cond_init( &r->cv, NULL ) )
+    {
+        x264_pthread_mutex_destroy( &r->mutex );
+        return -1;
+    }
+    if( x264_pthread_create( &r->thread, NULL, (void*)rendition_thread, r ) )
+    {
+        x264_pthread_cond_destroy( &r->cv );
+        x264_pthread_mutex_destroy( &r->mutex );
+        return -1;
+    }
+    r->b_thread = 1;
+#endif
+    return 0;
+}
+
+static void stop_rendition_thread( cli_rendition_t *r )
+{
+#if HAVE_THREAD
+    if( !r->b_thread )
+        return;
+    x264_pthread_mutex_lock( &r->mutex );
+    r->b_stop = 1;
+    x264_pthread_cond_broadcast( &r->cv );
+    x264_pthread_mutex_unlock( &r->mutex );
+    x264_pthread_join( r->thread, NULL );
+    x264_pthread_cond_destroy( &r->cv );
+    x264_pthread_mutex_destroy( &r->mutex );
+    r->b_thread = 0;
+#endif
+}
+
+/* Hand the rendition the main encode's current picture, or a flush if pic is
+ * NULL. With a thread it runs alongside the main encode until finish_rendition;
+ * the fork holds the shared frame unchanged meanwhile, as nothing else asks it
+ * for another one. */
+static void start_rendition( cli_rendition_t *r, x264_picture_t *pic, int i_frame )
+{
+    r->b_flush = !pic;
+    if( pic )
+        r->pic = *pic;
+    r->i_frame = i_frame;
+#if HAVE_THREAD
+    if( r->b_thread )
+    {
+        x264_pthread_mutex_lock( &r->mutex );
+        r->b_busy = 1;
+        x264_pthread_cond_broadcast( &r->cv );
+        x264_pthread_mutex_unlock( &r->mutex );
+        return;
+    }
+#endif
+    r->ret = run_rendition_job( r );
+}
+
+/* Wait for the job given by start_rendition and return its result. */
+static int finish_rendition( cli_rendition_t *r )
+{
+#if HAVE_THREAD
+    if( r->b_thread )
+    {
+        x264_pthread_mutex_lock( &r->mutex );
+        while( r->b_busy )
+            x264_pthread_cond_wait( &r->cv, &r->mutex );
+        x264_pthread_mutex_unlock( &r->mutex );
+    }
+#endif
+    output_stall_time += r->stall_time;
+    r->stall_time = 0;
+    return r->ret;
+}
+
 #define FAIL_IF_ERROR2( cond, ... )\
 do\
 {\
@@ -1963,7 +2541,7 @@ static int encode( x264_param_t *param, cli_opt_t *opt )
 
     x264_encoder_parameters( h, param );
 
-    FAIL_IF_ERROR2( cli_output.set_param( opt->hout, param ), "can't set outfile param\n" );
+    FAIL_IF_ERROR2( opt->hout && cli_output.set_param( opt->hout, param ), "can't set outfile param\n" );
 
     i_start = x264_mdate();
 
@@ -1972,7 +2550,7 @@ static int encode( x264_param_t *param, cli_opt_t *opt )
     FAIL_IF_ERROR2( ticks_per_frame < 1 && !param->b_vfr_input, "ticks_per_frame invalid: %"PRId64"\n", ticks_per_frame );
     ticks_per_frame = X264_MAX( ticks_per_frame, 1 );
 
-    if( !param->b_repeat_headers )
+    if( !param->b_repeat_headers && opt->hout )
     {
         // Write SPS/PPS/SEI
         x264_nal_t *headers;
@@ -1982,9 +2560,33 @@ static int encode( x264_param_t *param, cli_opt_t *opt )
         FAIL_IF_ERROR2( (i_file = cli_output.write_headers( opt->hout, headers )) < 0, "error writing headers to output file\n" );
     }
 
+    for( int i = 0; i < opt->i_renditions; i++ )
+    {
+        cli_rendition_t *r = &opt->rendition[i];
+        r->param.b_pulldown = param->b_pulldown;
+        r->param.b_pic_struct = param->b_pic_struct;
+        r->param.i_timebase_num = param->i_timebase_num;
+        r->param.i_timebase_den = param->i_timebase_den;
+        r->h = x264_encoder_open( &r->param );
+        FAIL_IF_ERROR2( !r->h, "x264_encoder_open failed for rendition `%s'\n", r->filename );
+        x264_encoder_parameters( r->h, &r->param );
+        FAIL_IF_ERROR2( r->output.set_param( r->hout, &r->param ), "can't set outfile param\n" );
+        if( !r->param.b_repeat_headers )
+        {
+            x264_nal_t *headers;
+            int i_nal;
+            FAIL_IF_ERROR2( x264_encoder_headers( r->h, &headers, &i_nal ) < 0, "x264_encoder_headers failed\n" );
+            FAIL_IF_ERROR2( (r->i_file = r->output.write_headers( r->hout, headers )) < 0, "error writing headers to output file\n" );
+        }
+        FAIL_IF_ERROR2( start_rendition_thread( r ), "could not start the thread for rendition `%s'\n", r->filename );
+    }
+
     if( opt->tcfile_out )
         fprintf( opt->tcfile_out, "# timecode format v2\n" );
 
+    int64_t i_cut_ticks = x264_cli_fragment_ticks( opt->fragment_duration, param );
+    int64_t i_next_cut = 0;
+
     /* Encode frames */
     for( ; !b_ctrl_c && (i_frame < param->i_frame_total || !param->i_frame_total); i_frame++ )
     {
@@ -2024,8 +2626,24 @@ static int encode( x264_param_t *param, cli_opt_t *opt )
         if( opt->qpfile )
             parse_qpfile( opt, &pic, i_frame + opt->i_seek );
 
+        /* Fragment cuts fall on a grid from the first frame: start each with an IDR. */
+        if( i_cut_ticks )
+        {
+            if( !i_frame )
+                i_next_cut = pic.i_pts;
+            if( pic.i_pts >= i_next_cut )
+            {
+                pic.i_type = X264_TYPE_IDR;
+                while( i_next_cut <= pic.i_pts )
+                    i_next_cut += i_cut_ticks;
+            }
+        }
+
+        for( int i = 0; i < opt->i_renditions; i++ )
+            start_rendition( &opt->rendition[i], &pic, i_frame + opt->i_seek );
+
         prev_dts = last_dts;
-        i_frame_size = encode_frame( h, opt->hout, &pic, &last_dts );
+        i_frame_size = encode_frame( h, &cli_output, opt->hout, opt->mb_stats, param, &pic, &last_dts );
         if( i_frame_size < 0 )
         {
             b_ctrl_c = 1; /* lie to exit the loop */
@@ -2039,6 +2657,13 @@ static int encode( x264_param_t *param, cli_opt_t *opt )
                 first_dts = prev_dts = last_dts;
         }
 
+        for( int i = 0; i < opt->i_renditions; i++ )
+            if( finish_rendition( &opt->rendition[i] ) < 0 )
+            {
+                b_ctrl_c = 1; /* lie to exit the loop */
+                retval = -1;
+            }
+
         if( filter.release_frame( opt->hin, &cli_pic, i_frame + opt->i_seek ) )
             break;
 
@@ -2047,10 +2672,12 @@ static int encode( x264_param_t *param, cli_opt_t *opt )
             i_previous = print_status( i_start, i_previous, i_frame_output, param->i_frame_total, i_file, param, 2 * last_dts - prev_dts - first_dts );
     }
     /* Flush delayed frames */
+    for( int i = 0; i < opt->i_renditions; i++ )
+        start_rendition( &opt->rendition[i], NULL, 0 );
     while( !b_ctrl_c && x264_encoder_delayed_frames( h ) )
     {
         prev_dts = last_dts;
-        i_frame_size = encode_frame( h, opt->hout, NULL, &last_dts );
+        i_frame_size = encode_frame( h, &cli_output, opt->hout, opt->mb_stats, param, NULL, &last_dts );
         if( i_frame_size < 0 )
         {
             b_ctrl_c = 1; /* lie to exit the loop */
@@ -2066,7 +2693,15 @@ static int encode( x264_param_t *param, cli_opt_t *opt )
         if( opt->b_progress && i_frame_output )
             i_previous = print_status( i_start, i_previous, i_frame_output, param->i_frame_total, i_file, param, 2 * last_dts - prev_dts - first_dts );
     }
+    for( int i = 0; i < opt->i_renditions; i++ )
+        if( finish_rendition( &opt->rendition[i] ) < 0 )
+        {
+            b_ctrl_c = 1; /* lie to exit the loop */
+            retval = -1;
+        }
 fail:
+    for( int i = 0; i < opt->i_renditions; i++ )
+        stop_rendition_thread( &opt->rendition[i] );
     if( pts_warning_cnt >= MAX_PTS_WARNING && cli_log_level < X264_LOG_DEBUG )
         x264_cli_log( "x264", X264_LOG_WARNING, "%d suppressed nonmonotonic pts warnings\n", pts_warning_cnt-MAX_PTS_WARNING );
 
@@ -2089,7 +2724,8 @@ fail:
     if( b_ctrl_c )
         fprintf( stderr, "aborted at input frame %d, output frame %d\n", opt->i_seek + i_frame, i_frame_output );
 
-    cli_output.close_file( opt->hout, largest_pts, second_largest_pts );
+    if( opt->hout )
+        cli_output.close_file( opt->hout, largest_pts, second_largest_pts );
     opt->hout = NULL;
 
     if( i_frame_output > 0 )
@@ -2101,5 +2737,20 @@ fail:
                  (double) i_file * 8 / ( 1000 * duration ) );
     }
 
+    for( int i = 0; i < opt->i_renditions; i++ )
+    {
+        cli_rendition_t *r = &opt->rendition[i];
+        if( r->h )
+        {
+            fprintf( stderr, "\nrendition %dx%d `%s':\n", r->param.i_width, r->param.i_height, r->filename );
+            x264_encoder_close( r->h );
+            r->h = NULL;
+        }
+        r->output.close_file( r->hout, largest_pts, second_largest_pts );
+        r->hout = NULL;
+        if( r->i_frame_output > 0 )
+            fprintf( stderr, "encoded %d frames, %.2f kb/s\n", r->i_frame_output, (double) r->i_file * 8 / ( 1000 * duration ) );
+    }
+
     return retval;
 }
@@ -45,7 +45,7 @@ extern "C" {
 
 #include "x264_config.h"
 
-#define X264_BUILD 165
+#define X264_BUILD 174
 
 #ifdef _WIN32
 #   define X264_DLL_IMPORT __declspec(dllimport)
@@ -316,6 +316,8 @@ typedef struct x264_param_t
     int         i_threads;           /* encode multiple frames in parallel */
     int         i_lookahead_threads; /* multiple threads for lookahead analysis */
     int         b_sliced_threads;  /* Whether to use slice-based threading. */
+    int         b_cabac_thread;    /* Write the CABAC bitstream of each slice on a separate thread, pipelined with analysis.
+                                    * Turned off when analysis reads the cabac states (subme >= 6, trellis). */
     int         b_deterministic; /* whether to allow non-deterministic optimizations when threaded */
     int         b_cpu_independent; /* force canonical behavior rather than cpu-dependent optimal algorithms */
     int         i_sync_lookahead; /* threaded lookahead buffer */
@@ -425,15 +427,22 @@ typedef struct x264_param_t
         float        f_psy_rd; /* Psy RD strength */
         float        f_psy_trellis; /* Psy trellis strength */
         int          b_psy; /* Toggle all psy optimizations */
+        int          b_fast_rd_rate; /* CABAC RD: estimate residual bits from the context states at the start
+                                      * of each mb instead of adapting them. Faster, slightly less accurate. */
 
         int          b_mb_info;            /* Use input mb_info data in x264_picture_t */
         int          b_mb_info_update; /* Update the values in mb_info according to the results of encoding. */
+        int          b_static_detect;  /* Compare each input frame against the previous one and fill mb_info with
+                                        * X264_MBINFO_CONSTANT for identical macroblocks. Implies b_mb_info. */
 
         /* the deadzone size that will be used in luma quantization */
         int          i_luma_deadzone[2]; /* {inter, intra} */
 
         int          b_psnr;    /* compute and print PSNR stats */
         int          b_ssim;    /* compute and print SSIM stats */
+        int          b_vif;     /* compute and print VIF (visual information fidelity) stats */
+        int          b_mb_stats; /* return per-macroblock qp, ssd and ssim with each output picture;
+                                  * the CLI's --mb-stats <file> sets it and writes them to the file */
     } analyse;
 
     /* Rate control parameters */
@@ -449,6 +458,7 @@ typedef struct x264_param_t
         int         i_bitrate;
         float       f_rf_constant;  /* 1pass VBR, nominal QP */
         float       f_rf_constant_max;  /* In CRF mode, maximum CRF as caused by VBV */
+        float       f_target_ssim;  /* 1pass CRF: adjust the rate factor per scene to reach this mean SSIM, 0=disabled */
         float       f_rate_tolerance;
         int         i_vbv_max_bitrate;
         int         i_vbv_buffer_size;
@@ -470,6 +480,9 @@ typedef struct x264_param_t
         char        *psz_stat_out;  /* output filename (in UTF-8) of the 2pass stats file */
         int         b_stat_read;    /* Read stat from psz_stat_in and use it */
         char        *psz_stat_in;   /* input filename (in UTF-8) of the 2pass stats file */
+        int         b_stats_only;   /* First pass: only write the stats. CABAC is sized instead of coded and
+                                     * deblocking is skipped; x264_encoder_encode returns no NAL units, and
+                                     * the estimated frame size in place of the size of the NAL units. */
 
         /* 2pass params (same as ffmpeg ones) */
         float       f_qcompress;    /* 0.0 => cbr, 1.0 => constant qp */
@@ -480,6 +493,14 @@ typedef struct x264_param_t
         char        *psz_zones;     /* alternate method of specifying zones */
     } rc;
 
+    /* Speed control: adjust analysis settings frame by frame to hold a target encoding speed.
+     * The settings given in analyse are the upper bound; the controller never exceeds them. */
+    struct
+    {
+        float       f_speed;        /* target speed as a fraction of realtime (fps), 0=disabled */
+        int         i_buffer_size;  /* number of frames of slack the controller may absorb */
+    } sc;
+
     /* Cropping Rectangle parameters: added to those implicitly defined by
        non-mod16 video resolutions. */
     struct
@@ -824,6 +845,23 @@ typedef struct x264_image_properties_t
      *     Useful if one wants to use a different quant_offset array for each frame. */
     void (*quant_offsets_free)( void* );
 
+    /* In: optional array of analysis effort levels, one per macroblock, in the same layout
+     *     as quant_offsets.  Lets the caller spend less CPU on regions it doesn't care about
+     *     while keeping the full settings elsewhere.  Each level only lowers the encoder's
+     *     settings, never raises them. */
+    uint8_t *mb_effort;
+    /* In: optional callback to free mb_effort when used. */
+    void (*mb_effort_free)( void* );
+
+    /* The encoder's own settings. */
+    #define X264_EFFORT_FULL      0
+    /* subme <= 5, me <= hex, trellis <= 1, no partitions smaller than 8x8. */
+    #define X264_EFFORT_REDUCED   1
+    /* subme <= 2, dia, no trellis, only 16x16, 8x8 and i8x8 partitions. */
+    #define X264_EFFORT_LOW       2
+    /* subme <= 1, dia, no trellis, 16x16 partitions only. */
+    #define X264_EFFORT_MINIMAL   3
+
     /* In: optional array of flags for each macroblock.
      *     Allows specifying additional information for the encoder such as which macroblocks
      *     remain unchanged.  Usable flags are listed below.
@@ -856,9 +894,23 @@ typedef struct x264_image_properties_t
     double f_psnr_avg;
     /* Out: PSNR of Y, U, and V (if x264_param_t.b_psnr is set) */
     double f_psnr[3];
+    /* Out: VIF of the frame luma (if x264_param_t.b_vif is set) */
+    double f_vif;
 
     /* Out: Average effective CRF of the encoded frame */
     double f_crf_avg;
+
+    /* Out: if x264_param_t.analyse.b_mb_stats is set, statistics of each macroblock of the
+     *      encoded frame, in the same layout as quant_offsets.  The arrays belong to the
+     *      encoder and remain valid until the next call to x264_encoder_encode or
+     *      x264_encoder_close.  Regardless of b_psnr/b_ssim, they are computed against the
+     *      input picture over the visible part of each macroblock. */
+    /* QP the macroblock was coded with. */
+    int8_t   *mb_qp;
+    /* Sum of squared differences of luma and both chroma planes. */
+    uint32_t *mb_ssd;
+    /* Mean luma SSIM of the 8x8 windows within the macroblock, 1.0 if there are none. */
+    float    *mb_ssim;
 } x264_image_properties_t;
 
 typedef struct x264_picture_t
@@ -42,6 +42,7 @@ extern const char * const x264_log_level_names[];
 extern const char * const x264_partition_names[];
 extern const char * const x264_pulldown_names[];
 extern const char * const x264_range_names[];
+extern const char * const x264_dither_names[];
 extern const char * const x264_output_csp_names[];
 extern const char * const x264_valid_profile_names[];
 extern const char * const x264_demuxer_names[];